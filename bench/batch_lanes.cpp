@@ -0,0 +1,79 @@
+#include "../diffurch.hpp"
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <tuple>
+
+using namespace diffurch;
+using namespace diffurch::variables_xyz_t;
+
+// Throughput of the integration of an ensemble of Lorenz systems with
+// different rho: each trajectory separately with Solver::solution, and W
+// trajectories in lockstep with batch_solution, where the values are Lanes<W>.
+// Compile with -march=native to use the widest SIMD instructions.
+
+template <typename T> struct Lorenz : Solver<Lorenz<T>> {
+  T rho;
+  Lorenz(T rho_) : rho(rho_) {}
+  auto get_rhs() {
+    return 10. * (y - x) | x * (rho - z) - y | x * y - 8. / 3. * z;
+  }
+  auto get_ic() { return Constant(1.) | 2. | 20. + 0. * t; }
+};
+
+constexpr size_t trajectories = 64;
+constexpr double final_time = 20.;
+constexpr double stepsize = 0.01;
+
+double rho(size_t i) { return 0.5 + i * 1.5; }
+
+// the best of several runs
+template <typename F> double ns_per_trajectory_step(F f) {
+  double seconds = std::numeric_limits<double>::infinity();
+  volatile double checksum = 0.;
+  for (int run = 0; run < 3; run++) {
+    auto start = std::chrono::steady_clock::now();
+    checksum = checksum + f();
+    auto end = std::chrono::steady_clock::now();
+    seconds = std::min(
+        seconds, std::chrono::duration<double>(end - start).count());
+  }
+  return seconds / (trajectories * final_time / stepsize) * 1e9;
+}
+
+template <size_t W> double batched() {
+  return ns_per_trajectory_step([] {
+    double checksum = 0.;
+    for (size_t begin = 0; begin < trajectories; begin += W) {
+      Lanes<W> rhos;
+      for (size_t i = 0; i < W; i++)
+        rhos[i] = rho(begin + i);
+      Lorenz<Lanes<W>> eq(rhos);
+      auto x_final =
+          batch_solution(eq, 0., final_time, ConstantStepsize(stepsize));
+      checksum += x_final[0][0];
+    }
+    return checksum;
+  });
+}
+
+int main() {
+  double separate = ns_per_trajectory_step([] {
+    double checksum = 0.;
+    for (size_t i = 0; i < trajectories; i++) {
+      auto [x_final] = Lorenz<double>(rho(i)).solution(
+          0., final_time, ConstantStepsize(stepsize),
+          std::make_tuple(StopEvent(x)));
+      checksum += x_final[0];
+    }
+    return checksum;
+  });
+
+  std::cout << "lanes\tns per trajectory step\tspeedup\n";
+  std::cout << "separate\t" << separate << "\t1\n";
+  std::cout << "1\t" << batched<1>() << "\t" << separate / batched<1>() << "\n";
+  std::cout << "2\t" << batched<2>() << "\t" << separate / batched<2>() << "\n";
+  std::cout << "4\t" << batched<4>() << "\t" << separate / batched<4>() << "\n";
+  std::cout << "8\t" << batched<8>() << "\t" << separate / batched<8>() << "\n";
+  return 0;
+}
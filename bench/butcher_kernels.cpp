@@ -0,0 +1,92 @@
+#include "../diffurch.hpp"
+#include "../src/rk_tables/dp54.hpp"
+#include "../src/rk_tables/rk4.hpp"
+#include "../src/rk_tables/rktp64.hpp"
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+using namespace diffurch;
+
+// Time of the linear combinations of stages, that are computed in one step of
+// the Runge-Kutta method (x_prev + h * sum_j a[i][j] K[j] for each stage i,
+// and the combinations with b and bb), with the coefficients read from the
+// tables in a loop (dot(RK::a[i], K, i)), and with the loop unrolled at compile
+// time, where zero coefficients are skipped (dot<RK::a[i], i>(K)), and where
+// the error is combined with precomputed weights b - bb, as in the solver. The
+// evaluation of the right hand side is excluded.
+
+template <typename RK, size_t n> struct Stages {
+  Vec<n> x_prev;
+  std::array<Vec<n>, RK::s> K;
+  double h = 0.01;
+
+  Stages() {
+    for (size_t i = 0; i < n; i++)
+      x_prev[i] = 1. / (i + 1);
+    for (size_t j = 0; j < RK::s; j++)
+      for (size_t i = 0; i < n; i++)
+        K[j][i] = std::sin(double(j * n + i));
+  }
+
+  Vec<n> step_runtime() {
+    for (size_t i = 0; i < RK::s; i++)
+      K[i] = K[i] + 1e-3 * (x_prev + h * dot(RK::a[i], K, i));
+    Vec<n> x_curr = x_prev + h * dot(RK::b, K, RK::s);
+    return x_curr + h * (dot(RK::b, K, RK::s) - dot(RK::bb, K, RK::s));
+  }
+
+  Vec<n> step_compile_time() {
+    [&]<size_t... i>(std::index_sequence<i...>) {
+      ((K[i] = K[i] + 1e-3 * (x_prev + h * dot<RK::a[i], i>(K))), ...);
+    }(std::make_index_sequence<RK::s>{});
+    Vec<n> x_curr = x_prev + h * dot<RK::b, RK::s>(K);
+    return x_curr + h * dot<error_weights_v<RK>, RK::s>(K);
+  }
+};
+
+template <typename RK> size_t nonzero_coefficients() {
+  size_t count = 0;
+  for (size_t i = 0; i < RK::s; i++)
+    for (size_t j = 0; j < i; j++)
+      count += RK::a[i][j] != 0.;
+  for (size_t j = 0; j < RK::s; j++)
+    count += (RK::b[j] != 0.) + (RK::bb[j] != 0.);
+  return count;
+}
+
+// the best of several runs
+template <typename F> double time_per_step(F step) {
+  size_t steps = 100000;
+  double seconds = std::numeric_limits<double>::infinity();
+  volatile double sink = 0.;
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < steps; i++)
+      sink = sink + step()[0];
+    auto end = std::chrono::steady_clock::now();
+    seconds = std::min(
+        seconds, std::chrono::duration<double>(end - start).count());
+  }
+  return seconds / steps * 1e9;
+}
+
+template <typename RK, size_t n> void print_row(const char *name) {
+  Stages<RK, n> runtime, compile_time;
+  std::cout << name << "\t" << n << "\t" << nonzero_coefficients<RK>() << "/"
+            << RK::s * (RK::s + 3) / 2 << "\t"
+            << time_per_step([&] { return runtime.step_runtime(); }) << "\t"
+            << time_per_step([&] { return compile_time.step_compile_time(); })
+            << "\n";
+}
+
+int main() {
+  std::cout << "method\tn\tnonzero coefficients\tloop (ns/step)\tunrolled "
+               "(ns/step)\n";
+  print_row<rk43, 3>("rk43");
+  print_row<dp54, 3>("dp54");
+  print_row<rktp64, 3>("rktp64");
+  print_row<rk98, 3>("rk98");
+  print_row<rk98, 20>("rk98");
+  return 0;
+}
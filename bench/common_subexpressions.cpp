@@ -0,0 +1,107 @@
+#include "../diffurch.hpp"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <utility>
+
+using namespace diffurch;
+
+// Time of the solution with the identical subexpressions of the right hand
+// side evaluated once (the default), and with RepeatSubexpressions, where they
+// are evaluated each time they occur. The number of shared subexpressions is
+// printed, and the solutions should be the same.
+//
+// The neutral equation of examples/ndde_bomb.cpp evaluates D(x)(t - 1) twice,
+// and the variational equations (see lyapunov.hpp) repeat the subexpressions
+// of the equation in the derivatives. The repeated subexpressions of the
+// variational equations of Lorenz system are single operations, which are
+// not shared, and the linear delay equations have no repeated subexpressions,
+// so they show the overhead, which should be none.
+
+// the best times of f and g, which are run alternately, so that both are
+// measured under the same load
+template <typename F, typename G>
+std::pair<double, double> seconds_per_call(F f, G g) {
+  using clock = std::chrono::steady_clock;
+  auto time = [](auto function) {
+    size_t calls = 0;
+    auto start = clock::now();
+    double elapsed;
+    do {
+      function();
+      calls++;
+      elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < 0.02);
+    return elapsed / calls;
+  };
+  double best_f = std::numeric_limits<double>::infinity();
+  double best_g = best_f;
+  for (int run = 0; run < 10; run++) {
+    best_f = std::min(best_f, time(f));
+    best_g = std::min(best_g, time(g));
+  }
+  return {best_f, best_g};
+}
+
+struct NDDEBomb : Solver<NDDEBomb> {
+  double epsilon = 0.1;
+  double A = -0.1;
+  auto get_rhs() {
+    using namespace diffurch::variables_x_t;
+    return Vector(-x + (1 + epsilon) * D(x)(t - 1) + A * pow(D(x)(t - 1), 3));
+  }
+  auto get_ic() {
+    using namespace diffurch::variables_x_t;
+    return Vector(0.17 * sin(2 * M_PI * t));
+  }
+};
+
+// Mackey-Glass equation, with the delayed variable in the numerator and in
+// the denominator
+struct MackeyGlass : Solver<MackeyGlass> {
+  auto get_rhs() {
+    using namespace diffurch::variables_x_t;
+    return Vector(2. * x(t - 2.) / (1. + pow(x(t - 2.), 10)) - x);
+  }
+  auto get_ic() {
+    using namespace diffurch::variables_x_t;
+    return Vector(0.5 + 0. * t);
+  }
+};
+
+template <typename Equation>
+void print_equation(const std::string &name, Equation equation,
+                    double final_time, double stepsize) {
+  using Shared = SharedSubexpressions<decltype(equation.get_rhs())>;
+  auto solve = [&](auto... options) {
+    return equation.solution(0., final_time, ConstantStepsize(stepsize),
+                             std::make_tuple(StopEvent(Variable<0>())),
+                             options...);
+  };
+  auto [shared_time, repeated_time] = seconds_per_call(
+      [&] { solve(); }, [&] { solve(RepeatSubexpressions()); });
+  double difference = std::abs(std::get<0>(solve())[0] -
+                               std::get<0>(solve(RepeatSubexpressions()))[0]);
+  std::cout << name << "\t" << Shared::slots << "\t" << shared_time << "\t"
+            << repeated_time << "\t" << repeated_time / shared_time << "\t"
+            << difference << "\n";
+}
+
+int main() {
+  std::cout << "equation\tshared\ttime (s)\ttime repeated (s)\tspeedup\t"
+               "difference\n";
+  print_equation("ndde_bomb", NDDEBomb(), 200., 0.02);
+  print_equation("mackey_glass", MackeyGlass(), 200., 0.02);
+  print_equation("linear_dde1_exp", equation::LinearDDE1Exp(), 20., 0.01);
+  print_equation("linear_dde2_sin", equation::LinearDDE2Sin(), 20., 0.01);
+  print_equation("linear_ndde1_sin", equation::LinearNDDE1Sin(), 20., 0.01);
+  print_equation("mackey_glass_variational",
+                 Variational<MackeyGlass, 1>(MackeyGlass()), 200., 0.02);
+  print_equation("lorenz_variational",
+                 Variational<equation::Lorenz, 3>(equation::Lorenz()), 20.,
+                 0.01);
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "../diffurch.hpp"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace diffurch;
+
+// Time of evaluation of the derivatives D<k>(f) of f = sin(2t) exp(-t/2),
+// which are built by the product and chain rules, and of the same
+// derivatives written by hand. The zeros and ones from the derivatives of
+// the constants and of t are folded when the expressions are built, so the
+// number of nodes does not grow with `0 * ...` and `1 * ...` terms (before
+// the folding, there were 35, 146, and 636 nodes). The rest of the
+// difference is the product rule, which repeats sin, cos, and exp, that are
+// evaluated once by hand, and the like terms, that are not combined: the
+// folding does not collect the repeated products (e.g. x * x * x) or the
+// terms of the same product with different constant factors, so D<3> is
+// still several times slower than by hand (about 325 ns against 55 ns). The
+// time with SharedSubexpressions (see symbolic/common_subexpressions.hpp),
+// which evaluates the repeated sin, cos, and exp once, as the solver does, is
+// printed too. The sums are printed to check that the values agree.
+
+template <typename F> double seconds_per_call(F f) {
+  using clock = std::chrono::steady_clock;
+  double best = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 10; run++) {
+    size_t calls = 0;
+    auto start = clock::now();
+    double elapsed;
+    do {
+      f();
+      calls++;
+      elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < 0.01);
+    best = std::min(best, elapsed / calls);
+  }
+  return best;
+}
+
+// the number of nodes of the expression, that are evaluated from children
+template <typename T> constexpr size_t nodes() {
+  if constexpr (HasSubexpressions<T>) {
+    using Children =
+        std::remove_cvref_t<decltype(std::declval<const T &>().children())>;
+    return [&]<size_t... i>(std::index_sequence<i...>) {
+      return (1 + ... +
+              nodes<std::remove_cvref_t<std::tuple_element_t<i, Children>>>());
+    }(std::make_index_sequence<std::tuple_size_v<Children>>{});
+  } else {
+    return 1;
+  }
+}
+
+template <typename Expr, typename Hand>
+void print_derivative(const std::string &name, const Expr &expr, Hand hand,
+                      const std::vector<double> &times) {
+  double sum = 0., shared_sum = 0., hand_sum = 0.;
+  double time = seconds_per_call([&] {
+    sum = 0.;
+    for (double t : times)
+      sum += expr(t);
+  });
+  SharedSubexpressions<Expr> shared(expr);
+  double shared_time = seconds_per_call([&] {
+    shared_sum = 0.;
+    for (double t : times)
+      shared_sum += shared(expr, t);
+  });
+  double hand_time = seconds_per_call([&] {
+    hand_sum = 0.;
+    for (double t : times)
+      hand_sum += hand(t);
+  });
+  std::cout << name << "\t" << nodes<Expr>() << "\t"
+            << time / times.size() * 1e9 << "\t"
+            << shared_time / times.size() * 1e9 << "\t"
+            << hand_time / times.size() * 1e9 << "\t" << sum << "\t"
+            << shared_sum << "\t" << hand_sum << "\n";
+}
+
+int main() {
+  static constexpr auto t = TimeVariable();
+  auto f = sin(2. * t) * exp(-0.5 * t);
+
+  std::vector<double> times(1000);
+  for (size_t i = 0; i < times.size(); i++)
+    times[i] = 0.01 * i;
+
+  std::cout << "derivative\tnodes\ttime symbolic (ns)\ttime shared (ns)\t"
+               "time by hand (ns)\tsum symbolic\tsum shared\tsum by hand\n";
+  print_derivative("D<1>", D<1>(f),
+                   [](double t) {
+                     return std::exp(-0.5 * t) *
+                            (2. * std::cos(2. * t) - 0.5 * std::sin(2. * t));
+                   },
+                   times);
+  print_derivative("D<2>", D<2>(f),
+                   [](double t) {
+                     return std::exp(-0.5 * t) *
+                            (-2. * std::cos(2. * t) - 3.75 * std::sin(2. * t));
+                   },
+                   times);
+  print_derivative("D<3>", D<3>(f),
+                   [](double t) {
+                     return std::exp(-0.5 * t) *
+                            (-6.5 * std::cos(2. * t) +
+                             5.875 * std::sin(2. * t));
+                   },
+                   times);
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include "../diffurch.hpp"
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace diffurch;
+
+// Strong scaling of ensemble_solution: the same ensemble of trajectories is
+// integrated with thread pools of different sizes. For Lorenz system the
+// parameter rho is swept with adaptive stepsize, so the number of steps
+// differs between trajectories; for the neutral delay equation from
+// examples/ndde_bomb.cpp the amplitude of the initial function is swept.
+
+struct Bomb : Solver<Bomb> {
+  double epsilon = 0.1;
+  double A = -0.1;
+  double amp;
+  Bomb(double amp_) : amp(amp_) {}
+
+  auto get_rhs() {
+    using namespace diffurch::variables_x_t;
+    return Vector(-x + (1 + epsilon) * D(x)(t - 1) + A * pow(D(x)(t - 1), 3));
+  }
+  auto get_ic() {
+    using namespace diffurch::variables_x_t;
+    return Vector(amp * sin(2 * M_PI * t));
+  }
+};
+
+template <typename F> double seconds(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+template <typename Equations, typename... Args>
+void print_scaling(const char *name, Equations &equations,
+                   const Args &...args) {
+  size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<size_t> thread_counts;
+  for (size_t num_threads = 1; num_threads < max_threads; num_threads *= 2)
+    thread_counts.push_back(num_threads);
+  thread_counts.push_back(max_threads);
+
+  double serial = 0.;
+  for (size_t num_threads : thread_counts) {
+    ThreadPool pool(num_threads);
+    double time =
+        seconds([&] { ensemble_solution(pool, equations, args...); });
+    if (num_threads == 1)
+      serial = time;
+    std::cout << name << "\t" << equations.size() << "\t" << num_threads
+              << "\t" << time << "\t" << serial / time << "\n";
+  }
+}
+
+int main() {
+  std::cout << "equation\ttrajectories\tthreads\ttime (s)\tspeedup\n";
+
+  {
+    using namespace diffurch::variables_xyz_t;
+    std::vector<equation::Lorenz> equations;
+    for (size_t i = 0; i < 256; i++)
+      equations.push_back(equation::Lorenz(10., 0.5 + i * 0.75));
+    print_scaling("lorenz", equations, 0., 100.,
+                  AdaptiveStepsize{.atol = 1e-10, .rtol = 1e-10},
+                  std::make_tuple(StopEvent(x | y | z)));
+  }
+
+  {
+    using namespace diffurch::variables_x_t;
+    std::vector<double> amplitudes;
+    for (size_t i = 0; i < 64; i++)
+      amplitudes.push_back(0.01 + i * 0.0025);
+    auto equations = make_equations<Bomb>(amplitudes);
+    print_scaling("ndde_bomb", equations, 0., 200., ConstantStepsize(1. / 50.),
+                  std::make_tuple(StopEvent(x)));
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+#include "../diffurch.hpp"
+#include <chrono>
+#include <iostream>
+
+using namespace diffurch;
+using namespace diffurch::variables_xyz_t;
+
+// Comparison of the root finding methods for event location on the Lorenz
+// map (see examples/lorenz_map.cpp), where the maximums of z are saved. The
+// first located times are compared with the ones located with bisection
+// (later ones diverge, because the system is chaotic).
+
+struct Lorenz : Solver<Lorenz> {
+  double sigma = 10., rho = 28., beta = 8. / 3.;
+
+  auto get_rhs() {
+    return sigma * (y - x) | x * (rho - z) - y | x * y - beta * z;
+  }
+  auto get_ic() { return Constant(1.1) | 1.2 | 20.; }
+};
+
+template <typename RootFinder>
+auto lorenz_map(double final_time, RootFinder root_finder) {
+  Lorenz eq;
+  return eq.solution(
+      0, final_time, ConstantStepsize(0.01),
+      std::make_tuple(
+          Event(When(x * y - eq.beta * z < 0, root_finder), t | z),
+          // the same event, but without saving, to have more locations
+          Event(When(x * y - eq.beta * z > 0, root_finder), nullptr)));
+}
+
+template <typename RootFinder>
+void benchmark(const char *name, RootFinder root_finder) {
+  double final_time = 50.;
+  double seconds = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    lorenz_map(final_time, root_finder);
+    auto end = std::chrono::steady_clock::now();
+    seconds = std::min(seconds,
+                       std::chrono::duration<double>(end - start).count());
+  }
+
+  auto [t_max, z_max] = lorenz_map(final_time, root_finder);
+  auto [t_max_bisection, z_max_bisection] =
+      lorenz_map(final_time, Bisection());
+  double max_difference = 0.;
+  for (size_t i = 0; i < 10; i++)
+    max_difference =
+        std::max(max_difference, std::abs(t_max[i] - t_max_bisection[i]));
+
+  std::cout << name << "\t" << t_max.size() << "\t" << max_difference << "\t"
+            << seconds << "\n";
+}
+
+int main() {
+  std::cout << "method\tevents\tdifference\ttime(s)\n";
+  benchmark("bisection", Bisection());
+  benchmark("illinois", Illinois());
+  benchmark("brent", Brent());
+  benchmark("newton", Newton());
+  benchmark("brent(1e-10)", Brent(1e-10));
+  return 0;
+}
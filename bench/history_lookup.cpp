@@ -0,0 +1,50 @@
+#include "../diffurch.hpp"
+#include <chrono>
+#include <iostream>
+
+using namespace diffurch;
+using namespace diffurch::variables_x_t;
+
+// Time per step for integration on increasing intervals. The delay is state
+// dependent, so the whole history is stored, and the cost of the lookup of
+// the past steps should not grow with the number of steps.
+
+// Mackey-Glass equations, that have chaotic solutions
+struct StateDependentDelay : Solver<StateDependentDelay> {
+  auto get_rhs() {
+    auto x_delayed = x(t - 2. - 0.1 * sin(x));
+    return Vector(2. * x_delayed / (1. + pow(x_delayed, 10)) - x);
+  }
+  auto get_ic() { return Vector(0.5 + 0. * t); }
+};
+
+struct ConstantDelay : Solver<ConstantDelay> {
+  auto get_rhs() {
+    auto x_delayed = x(t - 2.);
+    return Vector(2. * x_delayed / (1. + pow(x_delayed, 10)) - x);
+  }
+  auto get_ic() { return Vector(0.5 + 0. * t); }
+};
+
+template <typename Equation> void benchmark(const char *name) {
+  std::cout << name << "\n";
+  std::cout << "steps\tx(final_time)\ttime(s)\tns/step\n";
+  double stepsize = 0.01;
+  for (double final_time = 100.; final_time <= 10000.; final_time *= 10) {
+    auto start = std::chrono::steady_clock::now();
+    auto [x_final] = Equation().solution(
+        0., final_time, ConstantStepsize(stepsize),
+        std::make_tuple(StopEvent(x)));
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double steps = final_time / stepsize;
+    std::cout << steps << "\t" << x_final[0] << "\t" << seconds << "\t"
+              << seconds / steps * 1e9 << "\n";
+  }
+}
+
+int main() {
+  benchmark<StateDependentDelay>("state dependent delay");
+  benchmark<ConstantDelay>("constant delays");
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include "../diffurch.hpp"
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+using namespace diffurch;
+using namespace diffurch::variables_x_t;
+
+// Time per step for neutral delay equations, where the same delayed argument
+// appears several times in the right hand side. The interpolation weights for
+// such arguments are computed once per stage. For comparison, the equations
+// with slightly different delays are integrated, where the weights are
+// computed for each delayed variable separately.
+
+// see examples/ndde_bomb.cpp
+template <bool same_delays> struct Bomb : Solver<Bomb<same_delays>> {
+  double epsilon = 0.1;
+  double A = -0.1;
+
+  auto get_rhs() {
+    double tau2 = same_delays ? 1. : 1. + 1e-9;
+    return Vector(-x + (1 + epsilon) * D(x)(t - 1.) +
+                  A * pow(D(x)(t - tau2), 3));
+  }
+  auto get_ic() { return Vector(0.17 * sin(2 * M_PI * t)); }
+};
+
+// neutral equation with both x(t - tau) and D(x)(t - tau)
+template <bool same_delays>
+struct Neutral : Solver<Neutral<same_delays>> {
+  auto get_rhs() {
+    double tau2 = same_delays ? 1. : 1. + 1e-9;
+    return Vector(-x + 0.5 * x(t - 1.) - 0.5 * D(x)(t - 1.) +
+                  0.1 * x(t - tau2) * D(x)(t - tau2));
+  }
+  auto get_ic() { return Vector(sin(t)); }
+};
+
+// the best of several runs
+template <typename Equation> double time_per_step(double final_time) {
+  double stepsize = 0.01;
+  double seconds = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    Equation().solution(0., final_time, ConstantStepsize(stepsize),
+                        std::make_tuple(StopEvent(x)));
+    auto end = std::chrono::steady_clock::now();
+    seconds = std::min(
+        seconds, std::chrono::duration<double>(end - start).count());
+  }
+  return seconds / (final_time / stepsize) * 1e9;
+}
+
+int main() {
+  double final_time = 500.;
+  std::cout << "equation\tsame delays (ns/step)\tdifferent delays (ns/step)\n";
+  std::cout << "bomb\t" << time_per_step<Bomb<true>>(final_time) << "\t"
+            << time_per_step<Bomb<false>>(final_time) << "\n";
+  std::cout << "neutral\t" << time_per_step<Neutral<true>>(final_time) << "\t"
+            << time_per_step<Neutral<false>>(final_time) << "\n";
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include "../diffurch.hpp"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <tuple>
+
+using namespace diffurch;
+
+// The largest Lyapunov exponent of Lorenz system, computed by
+// lyapunov_exponents from the variational equation, and by the perturbed copy
+// of the solution, that is integrated together with the solution, and moved
+// back to the distance d after each step. The difference quotient of the
+// perturbed copy is accurate only when d is neither too large (then the
+// perturbation is not linear) nor too small (then the difference is dominated
+// by rounding errors), so the estimates by the copy scatter around the
+// variational one. The cost of one tangent vector is close to the cost of one
+// copy, since both double the system, but k exponents need k tangent vectors
+// instead of k copies with the choice of d. For each final time, the wall
+// time and the exponent are printed, and for the variational equation, also
+// the time of the full spectrum and the sum of exponents, which is exactly
+// -(10 + 1 + 8/3).
+
+template <typename F> double seconds_per_call(F f) {
+  using clock = std::chrono::steady_clock;
+  double best = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 3; run++) {
+    size_t calls = 0;
+    auto start = clock::now();
+    double elapsed;
+    do {
+      f();
+      calls++;
+      elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < 0.01);
+    best = std::min(best, elapsed / calls);
+  }
+  return best;
+}
+
+// Lorenz system and its copy, that starts at the distance d
+struct PerturbedLorenz : Solver<PerturbedLorenz> {
+  double d;
+  PerturbedLorenz(double d_) : d(d_) {}
+
+  static constexpr auto t = TimeVariable();
+  static constexpr auto x = Variable<0>(), y = Variable<1>(),
+                        z = Variable<2>();
+  static constexpr auto u = Variable<3>(), v = Variable<4>(),
+                        w = Variable<5>();
+
+  auto get_rhs() {
+    return 10. * (y - x) | x * (28. - z) - y | x * y - 8. / 3. * z |
+           10. * (v - u) | u * (28. - w) - v | u * v - 8. / 3. * w;
+  }
+  auto get_ic() {
+    return Constant(1.) | 1. | 1. | 1. + d | 1. | 1. + 0. * t;
+  }
+};
+
+double perturbed_copy_exponent(double d, double final_time) {
+  double log_growth = 0.;
+  auto renormalize_handler = [&](auto &state) {
+    double distance = 0.;
+    for (size_t j = 0; j < 3; j++)
+      distance += std::pow(state.x_curr[j + 3] - state.x_curr[j], 2);
+    distance = std::sqrt(distance);
+    log_growth += std::log(distance / d);
+    for (size_t j = 0; j < 3; j++)
+      state.x_curr[j + 3] =
+          state.x_curr[j] +
+          d / distance * (state.x_curr[j + 3] - state.x_curr[j]);
+  };
+  auto renormalize = StepEvent(
+      nullptr, handler_reading(Variable<>(), renormalize_handler));
+  PerturbedLorenz(d).solution(0., final_time, ConstantStepsize(0.01),
+                              std::make_tuple(renormalize));
+  return log_growth / final_time;
+}
+
+int main() {
+  std::cout << "final time\tmethod\ttime (s)\texponent\n";
+  for (double final_time : {100., 1000.}) {
+    double exponent = 0.;
+    double time = seconds_per_call([&] {
+      exponent =
+          lyapunov_exponents<1>(equation::Lorenz(), 0., final_time)[0];
+    });
+    std::cout << final_time << "\tvariational\t" << time << "\t" << exponent
+              << "\n";
+
+    for (double d : {1e-4, 1e-8, 1e-12}) {
+      time = seconds_per_call(
+          [&] { exponent = perturbed_copy_exponent(d, final_time); });
+      std::cout << final_time << "\tcopy d=" << d << "\t" << time << "\t"
+                << exponent << "\n";
+    }
+
+    std::array<double, 3> spectrum;
+    time = seconds_per_call([&] {
+      spectrum = lyapunov_exponents<3>(equation::Lorenz(), 0., final_time);
+    });
+    std::cout << final_time << "\tvariational, 3 exponents\t" << time << "\t"
+              << spectrum[0] << " " << spectrum[1] << " " << spectrum[2]
+              << " (sum + 41/3 = " << spectrum[0] + spectrum[1] + spectrum[2] +
+                                          41. / 3.
+              << ")\n";
+  }
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include "../diffurch.hpp"
+#include "../src/runtime/jit.hpp"
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <tuple>
+
+using namespace diffurch;
+
+// Time of the solution of the equations with the right hand side defined at
+// runtime (see RuntimeEquation), which is evaluated by the bytecode
+// interpreter, or compiled to native code (see compile in
+// src/runtime/jit.hpp), and of the same equations with the symbolic right
+// hand side. The time of parsing and of the compilation (with the empty cache,
+// and from the cache) is printed separately, and the difference of the
+// solutions should be at the level of rounding errors.
+
+template <typename F> double seconds_per_call(F f) {
+  using clock = std::chrono::steady_clock;
+  double best = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 5; run++) {
+    size_t calls = 0;
+    auto start = clock::now();
+    double elapsed;
+    do {
+      f();
+      calls++;
+      elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < 0.02);
+    best = std::min(best, elapsed / calls);
+  }
+  return best;
+}
+
+// Mackey-Glass equation
+struct MackeyGlass : Solver<MackeyGlass> {
+  auto get_rhs() {
+    using namespace diffurch::variables_x_t;
+    return Vector(2. * x(t - 2.) / (1. + pow(x(t - 2.), 10)) - x);
+  }
+  auto get_ic() {
+    using namespace diffurch::variables_x_t;
+    return Vector(0.5 + 0. * t);
+  }
+};
+
+template <size_t n, typename Equation, typename Parse>
+void print_equation(const std::string &name, Equation equation, Parse parse,
+                    double final_time, double stepsize) {
+  using clock = std::chrono::steady_clock;
+  auto stop = std::make_tuple(StopEvent(Variable<0>()));
+  auto solve = [&](auto &equation) {
+    return equation.solution(0., final_time, ConstantStepsize(stepsize), stop);
+  };
+  double parse_time = seconds_per_call([&] { parse(); });
+  RuntimeEquation<n> runtime_equation = parse();
+  double runtime_time = seconds_per_call([&] { solve(runtime_equation); });
+
+  JitOptions options;
+  options.cache_directory =
+      std::filesystem::temp_directory_path() / "diffurch_bench_runtime_jit";
+  std::filesystem::remove_all(options.cache_directory);
+  RuntimeEquation<n> compiled_equation = parse();
+  auto start = clock::now();
+  bool is_compiled = compile(compiled_equation, options);
+  double compile_time =
+      std::chrono::duration<double>(clock::now() - start).count();
+  if (!is_compiled)
+    std::cerr << compiled_equation.rhs.compiled->error << "\n";
+  double cached_time = seconds_per_call([&] {
+    RuntimeEquation<n> cached_equation = parse();
+    compile(cached_equation, options);
+  });
+  double compiled_time = seconds_per_call([&] { solve(compiled_equation); });
+  std::filesystem::remove_all(options.cache_directory);
+
+  double symbolic_time = seconds_per_call([&] { solve(equation); });
+  auto [x_runtime] = solve(runtime_equation);
+  auto [x_compiled] = solve(compiled_equation);
+  auto [x_symbolic] = solve(equation);
+  double difference = std::max(std::abs(x_runtime[0] - x_symbolic[0]),
+                               std::abs(x_compiled[0] - x_symbolic[0]));
+  std::cout << name << "\t" << runtime_equation.rhs.bytecode->code.size()
+            << "\t" << parse_time << "\t" << compile_time << "\t"
+            << cached_time << "\t" << runtime_time << "\t" << compiled_time
+            << "\t" << symbolic_time << "\t" << runtime_time / symbolic_time
+            << "\t" << compiled_time / symbolic_time << "\t" << difference
+            << "\n";
+}
+
+int main() {
+  std::cout << "equation\tinstructions\tparse (s)\tcompile (s)\t"
+               "cached (s)\truntime (s)\tcompiled (s)\tsymbolic (s)\t"
+               "runtime ratio\tcompiled ratio\tdifference\n";
+  print_equation<3>(
+      "lorenz", equation::Lorenz(),
+      [] {
+        return RuntimeEquation<3>(
+            {"x", "y", "z"},
+            {"sigma * (y - x)", "x * (rho - z) - y", "x * y - beta * z"},
+            {"1.1", "1.2", "20"},
+            {{"sigma", 10.}, {"rho", 28.}, {"beta", 8. / 3.}});
+      },
+      20., 0.01);
+  print_equation<1>(
+      "mackey_glass", MackeyGlass(),
+      [] {
+        return RuntimeEquation<1>(
+            {"x"}, {"2 * x(t - 2) / (1 + x(t - 2)^10) - x"}, {"0.5"});
+      },
+      200., 0.02);
+  print_equation<1>(
+      "linear_dde1_exp", equation::LinearDDE1Exp(),
+      [] {
+        return RuntimeEquation<1>({"x"}, {"a * x + b * x(t - tau)"},
+                                  {"exp(t)"},
+                                  {{"a", 0.5}, {"b", 0.5 * std::exp(1.)},
+                                   {"tau", 1.}});
+      },
+      20., 0.01);
+  return 0;
+}
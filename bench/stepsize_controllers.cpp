@@ -0,0 +1,158 @@
+#include "../diffurch.hpp"
+#include "../src/rk_tables/dp54.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace diffurch;
+
+// Comparison of the stepsize controllers: the I controller AdaptiveStepsize,
+// the PI controller of Gustafsson PIStepsize, and the PID controller of
+// Söderlind PIDStepsize. All of them measure the error in the max norm
+// (AdaptiveStepsize has no other, and PIStepsize and PIDStepsize use
+// rms_norm = false, except the run "PI (rms norm)" with their default norm).
+// The same tolerance is still not the same achieved error: AdaptiveStepsize
+// scales the error by |x_curr|, while the others by max(|x_prev|, |x_curr|)
+// (see scaled_error_norm), and AdaptiveStepsize aims at the error
+// 1 / safety_factor. So each controller is run for the tolerances from 1e-3 to
+// 1e-12, and the number of rhs evaluations and of rejected steps is
+// interpolated (linearly in the logarithms) at the same achieved errors.
+//
+// The first table has a line for each run: the number of rhs evaluations,
+// accepted and rejected steps (see CollectStatistics), and the relative error
+// at the final time. The second table has the costs at the achieved errors
+// 1e-5, 1e-7 and 1e-9, by which the controllers are compared.
+
+template <size_t n> auto final_state(const auto &solution) {
+  return [&]<size_t... i>(std::index_sequence<i...>) {
+    return Vec<n>{std::get<1 + i>(solution).back()...};
+  }(std::make_index_sequence<n>{});
+}
+
+struct Run {
+  double error;
+  double rhs_calls;
+  double rejected_steps;
+};
+
+template <typename RK, typename Equation, typename StepsizeController>
+Run print_run(const std::string &equation_name, const char *controller_name,
+              Equation equation, double initial_time, double final_time,
+              const auto &reference, double tolerance,
+              StepsizeController stepsize_controller) {
+  static constexpr size_t n =
+      std::tuple_size_v<std::remove_cvref_t<decltype(reference)>>;
+  auto solution = equation.template solution<RK>(
+      initial_time, final_time, stepsize_controller,
+      std::make_tuple(StopEvent(SaveAll<Equation>())), CollectStatistics());
+  Statistics statistics = std::get<n + 1>(solution);
+  auto x = final_state<n>(solution);
+  double error = norm(x - reference) / (1. + norm(reference));
+  std::cout << equation_name << "\t" << controller_name << "\t" << tolerance
+            << "\t" << statistics.rhs_calls << "\t"
+            << statistics.accepted_steps << "\t" << statistics.rejected_steps
+            << "\t" << error << "\n";
+  return {error, double(statistics.rhs_calls),
+          double(statistics.rejected_steps)};
+}
+
+// the cost at the achieved error, interpolated between the two runs with the
+// closest errors above and below it, or nan, if there are no such runs
+Run cost_at_error(std::vector<Run> runs, double error) {
+  std::sort(runs.begin(), runs.end(),
+            [](const Run &a, const Run &b) { return a.error > b.error; });
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  for (size_t i = 0; i + 1 < runs.size(); i++) {
+    const Run &a = runs[i], &b = runs[i + 1];
+    if (a.error >= error && error >= b.error && a.error > b.error) {
+      double theta = std::log(a.error / error) / std::log(a.error / b.error);
+      return {error,
+              std::exp(std::log(a.rhs_calls) +
+                       theta * std::log(b.rhs_calls / a.rhs_calls)),
+              a.rejected_steps + theta * (b.rejected_steps - a.rejected_steps)};
+    }
+  }
+  return {error, nan, nan};
+}
+
+template <typename RK, typename Equation>
+void print_controllers(const std::string &equation_name, Equation equation,
+                       double initial_time, double final_time,
+                       const auto &reference,
+                       std::vector<std::string> &comparison) {
+  auto sweep = [&](const char *controller_name, auto make_controller) {
+    std::vector<Run> runs;
+    for (int i = 6; i <= 24; i++) {
+      double tol = std::pow(10., -i / 2.);
+      runs.push_back(print_run<RK>(equation_name, controller_name, equation,
+                                   initial_time, final_time, reference, tol,
+                                   make_controller(tol)));
+    }
+    for (double error : {1e-5, 1e-7, 1e-9}) {
+      Run run = cost_at_error(runs, error);
+      std::ostringstream line;
+      line << equation_name << "\t" << controller_name << "\t" << error
+           << "\t" << std::round(run.rhs_calls) << "\t"
+           << std::round(run.rejected_steps);
+      comparison.push_back(line.str());
+    }
+  };
+  sweep("I", [](double tol) {
+    return AdaptiveStepsize{.atol = tol, .rtol = tol};
+  });
+  sweep("PI", [](double tol) {
+    return PIStepsize{.atol = tol, .rtol = tol, .rms_norm = false};
+  });
+  sweep("PI (rms norm)",
+        [](double tol) { return PIStepsize{.atol = tol, .rtol = tol}; });
+  sweep("PID", [](double tol) {
+    return PIDStepsize{.atol = tol, .rtol = tol, .rms_norm = false};
+  });
+  sweep("H211PI", [](double tol) {
+    return PIDStepsize{.atol = tol,
+                       .rtol = tol,
+                       .beta1 = 1. / 6.,
+                       .beta2 = 1. / 6.,
+                       .beta3 = 0.,
+                       .rms_norm = false};
+  });
+}
+
+int main() {
+  std::cout << "equation\tcontroller\ttolerance\trhs calls\taccepted\t"
+               "rejected\terror\n";
+  std::vector<std::string> comparison;
+
+  using namespace diffurch::equation;
+  {
+    LogLinearODE2Complex equation(0., 1., 5000., 1.);
+    auto reference = equation.get_ic()(6.28);
+    print_controllers<dp54>("log_linear_ode2_complex (dp54)", equation, 0.,
+                            6.28, reference, comparison);
+    print_controllers<rk98>("log_linear_ode2_complex (rk98)", equation, 0.,
+                            6.28, reference, comparison);
+  }
+  {
+    Lorenz equation;
+    auto reference = final_state<3>(equation.solution(
+        0., 10., ConstantStepsize(1e-4),
+        std::make_tuple(StopEvent(SaveAll<Lorenz>()))));
+    print_controllers<dp54>("lorenz (dp54)", equation, 0., 10., reference,
+                            comparison);
+    print_controllers<rk98>("lorenz (rk98)", equation, 0., 10., reference,
+                            comparison);
+  }
+
+  std::cout << "\nequation\tcontroller\tachieved error\trhs calls\t"
+               "rejected\n";
+  for (const auto &line : comparison)
+    std::cout << line << "\n";
+  return 0;
+}
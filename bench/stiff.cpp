@@ -0,0 +1,113 @@
+#include "../diffurch.hpp"
+#include "../src/rk_tables/dp54.hpp"
+#include "../src/rk_tables/rosenbrock23.hpp"
+#include <chrono>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+using namespace diffurch;
+
+// Explicit and Rosenbrock methods on the stiff equations of
+// src/equations/stiff.hpp, with adaptive stepsize for different tolerances.
+// For each run, the wall time, the statistics of the solver (see
+// CollectStatistics) and the relative error at the final time are printed.
+// The error is with respect to the analytic solution, or to the solution by
+// rosenbrock23 with a much smaller tolerance. The explicit method dp54 is
+// limited by stability, so its number of steps does not decrease with the
+// tolerance; for the Robertson equation, it is not run, because its small
+// concentration becomes negative, and the solution blows up. The same happens
+// for rosenbrock23 with the tolerances larger than the concentration (about
+// 1e-5), so smaller tolerances are used. rosenbrock23 is a W-method, so it
+// keeps the Jacobian and the LU decomposition over the steps (see
+// RosenbrockStages in src/rosenbrock.hpp): the columns of the Jacobians and of
+// the LU decompositions are about a half to two thirds of the steps.
+
+template <typename F> double seconds_per_call(F f) {
+  using clock = std::chrono::steady_clock;
+  double best = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 3; run++) {
+    size_t calls = 0;
+    auto start = clock::now();
+    double elapsed;
+    do {
+      f();
+      calls++;
+      elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < 0.01);
+    best = std::min(best, elapsed / calls);
+  }
+  return best;
+}
+
+// the last values of x, saved by StopEvent(SaveAll<Equation>()) after t
+template <size_t n> auto final_state(const auto &solution) {
+  return [&]<size_t... i>(std::index_sequence<i...>) {
+    return Vec<n>{std::get<1 + i>(solution).back()...};
+  }(std::make_index_sequence<n>{});
+}
+
+template <typename RK, typename Equation>
+void print_run(const std::string &equation_name, const char *method_name,
+               Equation equation, double final_time, const auto &reference,
+               double tolerance) {
+  static constexpr size_t n =
+      std::tuple_size_v<std::remove_cvref_t<decltype(reference)>>;
+  auto solve = [&](auto... options) {
+    return equation.template solution<RK>(
+        0., final_time, AdaptiveStepsize{.atol = tolerance, .rtol = tolerance},
+        std::make_tuple(StopEvent(SaveAll<Equation>())), options...);
+  };
+  double time = seconds_per_call([&] { solve(); });
+  auto solution = solve(CollectStatistics());
+  Statistics statistics = std::get<n + 1>(solution);
+  auto x = final_state<n>(solution);
+  double error = norm(x - reference) / (1. + norm(reference));
+
+  std::cout << equation_name << "\t" << method_name << "\t" << tolerance
+            << "\t" << time << "\t" << statistics.rhs_calls << "\t"
+            << statistics.accepted_steps << "\t" << statistics.rejected_steps
+            << "\t" << statistics.jacobian_evaluations << "\t"
+            << statistics.lu_decompositions << "\t" << error << "\n";
+}
+
+template <typename Equation>
+void print_equation(const std::string &equation_name, Equation equation,
+                    double final_time, std::initializer_list<double> tolerances,
+                    bool run_explicit = true) {
+  static constexpr size_t n =
+      std::tuple_size_v<decltype(equation.get_ic()(0.))>;
+  auto reference = [&] {
+    if constexpr (Equation::ic_is_true_solution) {
+      return equation.get_ic()(final_time);
+    } else {
+      return final_state<n>(equation.template solution<rosenbrock23>(
+          0., final_time, AdaptiveStepsize{.atol = 1e-11, .rtol = 1e-11},
+          std::make_tuple(StopEvent(SaveAll<Equation>()))));
+    }
+  }();
+
+  for (double tolerance : tolerances) {
+    if (run_explicit)
+      print_run<dp54>(equation_name, "dp54", equation, final_time, reference,
+                      tolerance);
+    print_run<rosenbrock23>(equation_name, "rosenbrock23", equation,
+                            final_time, reference, tolerance);
+  }
+}
+
+int main() {
+  std::cout << "equation\tmethod\ttolerance\ttime (s)\trhs calls\taccepted\t"
+               "rejected\tjacobians\tLU\terror\n";
+
+  using namespace diffurch::equation;
+  print_equation("prothero_robinson", ProtheroRobinson(-1e4), 10.,
+                 {1e-3, 1e-5, 1e-7});
+  print_equation("van_der_pol", VanDerPol(100.), 100., {1e-3, 1e-5, 1e-7});
+  print_equation("robertson", Robertson(), 40., {1e-6, 1e-8, 1e-10}, false);
+  return 0;
+}
@@ -0,0 +1,190 @@
+#include "../diffurch.hpp"
+#include "../src/rk_tables/dp54.hpp"
+#include "../src/rk_tables/rk4.hpp"
+#include "../src/rk_tables/rktp64.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+using namespace diffurch;
+
+// Work-precision table: each equation of src/equations is integrated with
+// each Runge-Kutta table, with constant stepsizes and with the adaptive
+// stepsize controllers (AdaptiveStepsize, PIStepsize and PIDStepsize) for
+// different tolerances. For each run, a line of comma separated values is
+// written: the wall time of one solution, the statistics of the solver (the
+// number of right hand side evaluations, accepted and rejected steps, calls of
+// event location and evaluations of event functions in root finding), and the
+// relative error at the final time (with respect to the analytic solution, or
+// to the solution with rk98 and a very small stepsize, if the analytic
+// solution is not known).
+//
+// Usage: work_precision [output.csv] (the table is printed, if the file is not
+// given). The tables of two versions can be compared line by line, and the
+// cheapest method for the required accuracy is the one with the smallest time
+// among the lines with smaller error.
+
+const char *header = "equation,method,controller,parameter,time_s,rhs_calls,"
+                     "accepted_steps,rejected_steps,locate_calls,"
+                     "root_finder_evaluations,error";
+
+// the best time of solution per call, with repetitions for short runs
+template <typename F> double seconds_per_call(F f) {
+  using clock = std::chrono::steady_clock;
+  double best = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 3; run++) {
+    size_t calls = 0;
+    auto start = clock::now();
+    double elapsed;
+    do {
+      f();
+      calls++;
+      elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < 0.01);
+    best = std::min(best, elapsed / calls);
+  }
+  return best;
+}
+
+// the last values of x, saved by StopEvent(SaveAll<Equation>()), which are
+// the last n vectors of the solution
+template <size_t n> auto final_state(const auto &solution) {
+  static constexpr size_t offset = std::tuple_size_v<
+      std::remove_cvref_t<decltype(solution)>> - n;
+  return [&]<size_t... i>(std::index_sequence<i...>) {
+    return Vec<n>{std::get<offset + i>(solution).back()...};
+  }(std::make_index_sequence<n>{});
+}
+
+template <typename RK, typename Equation, typename StepsizeController>
+void write_run(std::ostream &out, const std::string &equation_name,
+               const char *method_name, Equation equation, double initial_time,
+               double final_time, const auto &reference,
+               StepsizeController stepsize_controller,
+               const char *controller_name, double parameter) {
+  auto solve = [&](auto... options) {
+    return equation.template solution<RK>(
+        initial_time, final_time, stepsize_controller,
+        std::make_tuple(StopEvent(SaveAll<Equation>())), options...);
+  };
+
+  double time = seconds_per_call([&] { solve(); });
+
+  auto solution = solve(CollectStatistics());
+  Statistics statistics = std::get<std::tuple_size_v<decltype(solution)> - 1>(
+      solution);
+  auto saved = [&]<size_t... i>(std::index_sequence<i...>) {
+    return std::make_tuple(std::get<i>(solution)...);
+  }(std::make_index_sequence<std::tuple_size_v<decltype(solution)> - 1>{});
+
+  static constexpr size_t n =
+      std::tuple_size_v<std::remove_cvref_t<decltype(reference)>>;
+  auto x = final_state<n>(saved);
+  double error = norm(x - reference) / (1. + norm(reference));
+
+  out << equation_name << "," << method_name << "," << controller_name << ","
+      << parameter << "," << time << "," << statistics.rhs_calls << ","
+      << statistics.accepted_steps << "," << statistics.rejected_steps << ","
+      << statistics.locate_calls << "," << statistics.root_finder_evaluations
+      << "," << error << "\n";
+}
+
+template <typename RK>
+void write_method(std::ostream &out, const std::string &equation_name,
+                  const char *method_name, const auto &equation,
+                  double initial_time, double final_time,
+                  const auto &reference) {
+  for (double h : {0.1, 0.03, 0.01, 0.003})
+    write_run<RK>(out, equation_name, method_name, equation, initial_time,
+                  final_time, reference, ConstantStepsize(h), "constant", h);
+
+  // the tables without embedded method (rk4) are used with constant stepsize
+  // only
+  static constexpr bool is_embedded = requires { RK::bb; };
+
+  if constexpr (is_embedded) {
+    for (double tolerance : {1e-4, 1e-6, 1e-8, 1e-10, 1e-12}) {
+      write_run<RK>(out, equation_name, method_name, equation, initial_time,
+                    final_time, reference,
+                    AdaptiveStepsize{.atol = tolerance,
+                                     .rtol = tolerance,
+                                     .max_stepsize = 0.5},
+                    "adaptive", tolerance);
+      write_run<RK>(out, equation_name, method_name, equation, initial_time,
+                    final_time, reference,
+                    PIStepsize{.atol = tolerance,
+                               .rtol = tolerance,
+                               .max_stepsize = 0.5},
+                    "pi", tolerance);
+      write_run<RK>(out, equation_name, method_name, equation, initial_time,
+                    final_time, reference,
+                    PIDStepsize{.atol = tolerance,
+                                .rtol = tolerance,
+                                .max_stepsize = 0.5},
+                    "pid", tolerance);
+    }
+  }
+}
+
+template <typename Equation>
+void write_equation(std::ostream &out, const std::string &equation_name,
+                    Equation equation, double initial_time, double final_time) {
+  auto reference = [&] {
+    if constexpr (Equation::ic_is_true_solution) {
+      return equation.get_ic()(final_time);
+    } else {
+      static constexpr size_t n =
+          std::tuple_size_v<decltype(equation.get_ic()(0.))>;
+      return final_state<n>(equation.template solution<rk98>(
+          initial_time, final_time, ConstantStepsize(1e-4),
+          std::make_tuple(StopEvent(SaveAll<Equation>()))));
+    }
+  }();
+
+  write_method<rk4>(out, equation_name, "rk4", equation, initial_time,
+                    final_time, reference);
+  write_method<rk43>(out, equation_name, "rk43", equation, initial_time,
+                     final_time, reference);
+  write_method<dp54>(out, equation_name, "dp54", equation, initial_time,
+                     final_time, reference);
+  write_method<rktp64>(out, equation_name, "rktp64", equation, initial_time,
+                       final_time, reference);
+  write_method<rk98>(out, equation_name, "rk98", equation, initial_time,
+                     final_time, reference);
+}
+
+int main(int argc, char *argv[]) {
+  std::ofstream file;
+  if (argc > 1)
+    file.open(argv[1]);
+  std::ostream &out = argc > 1 ? file : std::cout;
+  out.precision(6);
+  out << header << "\n";
+
+  using namespace diffurch::equation;
+  write_equation(out, "harmonic_oscillator", HarmonicOscillator(), 0., 10.);
+  write_equation(out, "linear1", Linear1(), 0., 10.);
+  write_equation(out, "linear_ode1", LinearODE1(-2., 3.), 0., 5.);
+  write_equation(out, "log_oscillator", LogOscillator(), 0., 10.);
+  write_equation(out, "log_linear_ode2_complex",
+                 LogLinearODE2Complex(0., 1., 5000., 1.), 0., 6.28);
+  write_equation(out, "lorenz", Lorenz(), 0., 5.);
+  write_equation(out, "relay1", Relay1(), -1., 1.);
+  write_equation(out, "relay2", Relay2(), -0.001, 20.);
+  write_equation(out, "linear_dde1_exp", LinearDDE1Exp(), 0., 5.);
+  write_equation(out, "linear_dde1_sin", LinearDDE1Sin(), 0., 10.);
+  write_equation(out, "linear_dde2_sin", LinearDDE2Sin(), 0., 10.);
+  write_equation(out, "linear_ndde1_sin", LinearNDDE1Sin(), 0., 10.);
+  write_equation(out, "relay_dde1", RelayDDE1(-1., -0.3, 1.), 0., 10.);
+  // the stiff equations, with the moderate stiffness, so that the explicit
+  // methods finish in reasonable time (see bench/stiff.cpp for the stiff case,
+  // and for Robertson, on which the explicit methods overflow)
+  write_equation(out, "prothero_robinson", ProtheroRobinson(-1e3), 0., 2.);
+  write_equation(out, "van_der_pol", VanDerPol(10.), 0., 10.);
+  return 0;
+}
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "src/batch.hpp"
+#include "src/ensemble.hpp"
 #include "src/equations.hpp"
 #include "src/events.hpp"
+#include "src/lyapunov.hpp"
 #include "src/rk_tables.hpp"
+#include "src/runtime.hpp"
 #include "src/solver.hpp"
 #include "src/state.hpp"
 #include "src/stepsize.hpp"
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "solver.hpp"
+#include "stepsize.hpp"
+#include "symbolic.hpp"
+#include "util/lanes.hpp"
+#include "util/vec.hpp"
+#include <algorithm>
+#include <array>
+#include <ranges>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "rk_tables/rk98.hpp"
+
+namespace diffurch {
+
+// State of W trajectories, that are integrated in lockstep, with the same
+// time and stepsize. The values X are std::array<Lanes<W>, n>, i.e. the block
+// of n coordinates by W trajectories, so the symbolic expressions are
+// evaluated for all trajectories at once.
+template <typename RK, typename X> struct BatchState {
+  static constexpr size_t n = std::tuple_size_v<X>;
+  using Value = typename X::value_type;
+
+  double t_curr;
+  double t_prev;
+  double t_step;
+
+  X x_curr;
+  X x_prev;
+
+  std::array<X, RK::s> K_curr;
+
+  BatchState(double t_init, const X &x_init)
+      : t_curr(t_init), t_prev(t_init), x_curr(x_init), x_prev(x_init) {}
+};
+
+// x + h * sum_j coefs[j] * K[j], computed lane by lane with the unrolled
+// dot (see util/vec.hpp), so that the arithmetic is the same as for a single
+// trajectory, and the loops over lanes are vectorized
+template <const auto &coefs, size_t size, typename X, size_t s>
+X combine_stages(const X &x, double h, const std::array<X, s> &K) {
+  struct StageLane {
+    const std::array<X, s> &K;
+    size_t coordinate;
+    size_t lane;
+    double operator[](size_t j) const { return K[j][coordinate][lane]; }
+  };
+
+  X result;
+  for (size_t k = 0; k < x.size(); k++) {
+    for (size_t l = 0; l < X::value_type::width; l++) {
+      result[k][l] = x[k][l] + h * dot<coefs, size>(StageLane{K, k, l});
+    }
+  }
+  return result;
+}
+
+// Integrates the equation, whose parameters and initial conditions are Lanes
+// (e.g. `Lanes<4> rho` as a member, or `Constant(Lanes<4>(...)) | ...` as
+// get_ic()), that is, W trajectories at once, with constant stepsize. The
+// steps are the same as in equation.solution<RK>(initial_time, final_time,
+// stepsize_controller) for each trajectory. The value of save is stored after
+// each step (and at the initial time), and the vector of the values is
+// returned; without save, the state at the final time is returned. Delay
+// equations, and equations with events (including discontinuous functions
+// like dsign), are not supported.
+template <typename RK = rk98, typename Equation,
+          typename SaveHandler = std::nullptr_t>
+auto batch_solution(Equation &equation, double initial_time,
+                    double final_time, ConstantStepsize stepsize_controller,
+                    SaveHandler save = nullptr) {
+  static constexpr bool is_saving =
+      !std::is_same_v<SaveHandler, std::nullptr_t>;
+  auto rhs = equation.get_rhs();
+  SharedSubexpressions shared_rhs(rhs);
+  auto ic = equation.get_ic();
+  static_assert(!has_delayed_variable_v<decltype(rhs)>,
+                "delay equations can not be integrated in lockstep");
+  static_assert(
+      std::is_same_v<decltype(std::tuple_cat(equation.get_events(),
+                                             rhs.get_events())),
+                     std::tuple<>>,
+      "equations with events can not be integrated in lockstep");
+
+  // the values are Lanes, if either initial conditions or parameters are
+  using X_ic = decltype(ic(initial_time));
+  using X = decltype(rhs(std::declval<const BatchState<RK, X_ic> &>()));
+  X x_init;
+  std::ranges::copy(ic(initial_time), x_init.begin());
+  auto state = BatchState<RK, X>(initial_time, x_init);
+  state.t_step = stepsize_controller.initial_stepsize;
+
+  // without events, the last stage of FSAL methods is always reused
+  bool first_stage_is_known = false;
+
+  auto runge_kutta_stage = [&]<size_t i>() {
+    if constexpr (i == 0 && is_fsal_v<RK>) {
+      if (first_stage_is_known) {
+        state.t_curr = state.t_prev;
+        state.x_curr = state.x_prev;
+        state.K_curr[0] = state.K_curr[RK::s - 1];
+        return;
+      }
+    }
+    state.t_curr = state.t_prev + state.t_step * RK::c[i];
+    state.x_curr = combine_stages<RK::a[i], i>(state.x_prev, state.t_step,
+                                               state.K_curr);
+    state.K_curr[i] = shared_rhs(rhs, state);
+  };
+
+  auto saved = [&] {
+    if constexpr (is_saving)
+      return std::vector<decltype(save(state))>{save(state)};
+    else
+      return nullptr;
+  }();
+
+  while (state.t_curr < final_time) {
+    state.t_prev = state.t_curr;
+    state.x_prev = state.x_curr;
+
+    [&]<size_t... i>(std::index_sequence<i...>) {
+      (runge_kutta_stage.template operator()<i>(), ...);
+    }(std::make_index_sequence<RK::s>{});
+
+    if constexpr (RK::c[RK::s - 1] != 1.)
+      state.t_curr = state.t_prev + state.t_step;
+    state.x_curr = combine_stages<RK::b, RK::s>(state.x_prev, state.t_step,
+                                                state.K_curr);
+
+    state.t_step = std::min(state.t_step, final_time - state.t_curr);
+    first_stage_is_known = true;
+    if constexpr (is_saving)
+      saved.push_back(save(state));
+  }
+
+  if constexpr (is_saving)
+    return saved;
+  else
+    return state.x_curr;
+}
+
+// The value of the i-th lane of the batched value, e.g. of a saved vector.
+template <size_t W> double lane(const Lanes<W> &value, size_t i) {
+  return value[i];
+}
+inline double lane(double value, size_t) { return value; }
+template <typename T, size_t N>
+auto lane(const std::array<T, N> &value, size_t i) {
+  std::array<double, N> result;
+  for (size_t k = 0; k < N; k++)
+    result[k] = lane(value[k], i);
+  return result;
+}
+
+} // namespace diffurch
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "solver.hpp"
+#include "util/thread_pool.hpp"
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "rk_tables/rk98.hpp"
+
+namespace diffurch {
+
+// Solves each equation of the random access range equations with the same
+// arguments, as in equation.solution<RK, History>(args...), in parallel with
+// thread_pool, and returns the vector of the results in the order of
+// equations. The arguments (in particular, events with their save handlers)
+// are copied for each equation, so the saved values are separate. Set handlers
+// and CallEvent functions, that refer to external variables, are called
+// from different threads.
+template <typename RK = rk98, typename History = StepHistory,
+          std::ranges::random_access_range Equations, typename... Args>
+auto ensemble_solution(ThreadPool &thread_pool, Equations &&equations,
+                       const Args &...args) {
+  using Equation = std::ranges::range_value_t<Equations>;
+  using Result = decltype(std::declval<Equation &>()
+                              .template solution<RK, History>(args...));
+
+  size_t size = std::ranges::size(equations);
+  std::vector<Result> results(size);
+  thread_pool.for_each_index(size, [&](size_t i) {
+    results[i] =
+        std::ranges::begin(equations)[i].template solution<RK, History>(
+            args...);
+  });
+  return results;
+}
+
+// The same, with the thread pool of all hardware threads.
+template <typename RK = rk98, typename History = StepHistory,
+          std::ranges::random_access_range Equations, typename... Args>
+auto ensemble_solution(Equations &&equations, const Args &...args) {
+  ThreadPool thread_pool;
+  return ensemble_solution<RK, History>(thread_pool, equations, args...);
+}
+
+// Vector of equations, constructed from each tuple of parameters, e.g.
+// make_equations<equation::Lorenz>(std::vector{std::tuple(10., 28., 8. / 3.),
+// ...}), or from each single parameter.
+template <typename Equation, std::ranges::input_range Parameters>
+std::vector<Equation> make_equations(const Parameters &parameters) {
+  std::vector<Equation> equations;
+  for (const auto &p : parameters) {
+    using P = std::remove_cvref_t<decltype(p)>;
+    if constexpr (requires { std::tuple_size<P>::value; })
+      equations.push_back(std::make_from_tuple<Equation>(p));
+    else
+      equations.push_back(Equation(p));
+  }
+  return equations;
+}
+
+} // namespace diffurch
@@ -7,4 +7,5 @@
 #include "equations/lorenz.hpp"
 #include "equations/ode/linear.hpp"
 #include "equations/relay.hpp"
-/*#include "equations/relay_dde.hpp"*/
+#include "equations/relay_dde.hpp"
+#include "equations/stiff.hpp"
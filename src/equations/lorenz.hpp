@@ -5,9 +5,12 @@ namespace diffurch::equation {
 struct Lorenz : Solver<Lorenz> {
 
   double sigma, rho, beta;
+  // the constant initial condition
+  Vec<3> x0;
 
-  Lorenz(double sigma_ = 10., double rho_ = 28., double beta_ = 8. / 3.)
-      : sigma(sigma_), rho(rho_), beta(beta_) {};
+  Lorenz(double sigma_ = 10., double rho_ = 28., double beta_ = 8. / 3.,
+         Vec<3> x0_ = {1.1, 1.2, 20.})
+      : sigma(sigma_), rho(rho_), beta(beta_), x0(x0_) {};
 
   static const bool ic_is_true_solution = false;
 
@@ -15,6 +18,6 @@ struct Lorenz : Solver<Lorenz> {
     using namespace diffurch::variables_xyz_t;
     return sigma * (y - x) | x * (rho - z) - y | x * y - beta * z;
   }
-  auto get_ic() { return Constant(1.1) | 1.2 | 20.; }
+  auto get_ic() { return Constant(x0[0]) | x0[1] | x0[2]; }
 };
 } // namespace diffurch::equation
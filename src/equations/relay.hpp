@@ -46,8 +46,10 @@ struct Relay2 : Solver<Relay2> {
 
   auto get_rhs() { return Dx | -dsign(x); }
   auto get_ic() {
-    return periodic_continuation(
-        -T / 2, T / 2, 0.5 * t * (0.5 * T - abs(t)) | 0.25 * T - abs(t));
+    // the variational equation evaluates the derivative at the switches of
+    // dsign (see delta in symbolic/discontinuous.hpp)
+    return BackwardDifference{periodic_continuation(
+        -T / 2, T / 2, 0.5 * t * (0.5 * T - abs(t)) | 0.25 * T - abs(t))};
   }
   std::string repr(bool latex = true) {
     if (latex)
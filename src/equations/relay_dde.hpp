@@ -15,24 +15,30 @@ struct RelayDDE1 : Solver<RelayDDE1> {
 
   static const bool ic_is_true_solution = true;
 
-  auto get_rhs() { return Vector(k * x + alpha * sign(x(t - tau))); }
+  auto get_rhs() { return Vector(k * x + alpha * dsign(x(t - tau))); }
   auto get_ic() {
+    using std::exp, std::log;
     double a, b;
     if (k == 0) {
       a = -tau;
       b = 3 * tau;
-      return Periodic(a, b,
-                      Piecewise(t < tau, -alpha * t, alpha * (t - 2 * tau)));
     } else {
       a = tau + log(-1 + 2 * exp(-k * tau)) / k;
       b = tau - log(-1 + 2 * exp(-k * tau)) / k;
-      return Periodic(
-          a, b,
-          Piecewise(t < tau, alpha / k * (1 - exp(k * t)),
-                    -alpha / k * (1 + exp(k * t) * (1 - 2 * exp(-k * tau)))));
     }
+    // the derivative is used by the variational equation (see delta in
+    // symbolic/discontinuous.hpp)
+    return BackwardDifference{periodic_continuation(
+        a, b, [alpha = alpha, k = k, tau = tau](double s) {
+          using std::exp;
+          if (k == 0)
+            return Vec<1>{s < tau ? -alpha * s : alpha * (s - 2 * tau)};
+          else
+            return Vec<1>{s < tau ? alpha / k * (1 - exp(k * s))
+                                  : -alpha / k *
+                                        (1 + exp(k * s) *
+                                                 (1 - 2 * exp(-k * tau)))};
+        })};
   }
-
-  auto get_events() { return Events(StepEvent(std::make_tuple(t, x))); }
 };
 } // namespace diffurch::equation
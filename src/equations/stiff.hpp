@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../solver.hpp"
+
+namespace diffurch::equation {
+
+// Test equation of Prothero and Robinson, with the solution sin(t), which is
+// stiff for large negative lambda.
+struct ProtheroRobinson : Solver<ProtheroRobinson> {
+
+  double lambda;
+
+  ProtheroRobinson(double lambda_ = -1e6) : lambda(lambda_) {};
+
+  static constexpr auto t = TimeVariable();
+  static constexpr auto x = Variable<0>();
+
+  static const bool ic_is_true_solution = true;
+
+  auto get_rhs() { return Vector(lambda * (x - sin(t)) + cos(t)); }
+  auto get_ic() { return Vector(sin(t)); }
+
+  std::string repr(bool latex = true) {
+    std::string l = std::format("{:.3g}", lambda);
+    if (latex)
+      return "$\\dot x = " + l + " (x - \\sin t) + \\cos t$";
+    else
+      return "x' = " + l + "(x - sin(t)) + cos(t)";
+  }
+};
+
+// Van der Pol oscillator, which is stiff for large mu, with relaxation
+// oscillations of period about (3 - 2 log 2) mu.
+struct VanDerPol : Solver<VanDerPol> {
+
+  double mu;
+
+  VanDerPol(double mu_ = 1000.) : mu(mu_) {};
+
+  static constexpr auto t = TimeVariable();
+  static constexpr auto x = Variable<0>();
+  static constexpr auto Dx = Variable<1>();
+
+  static const bool ic_is_true_solution = false;
+
+  auto get_rhs() { return Dx | mu * (1. - x * x) * Dx - x; }
+  auto get_ic() { return Constant(2.) | 0.; }
+
+  std::string repr(bool latex = true) {
+    std::string m = std::format("{:.3g}", mu);
+    if (latex)
+      return "$\\ddot x = " + m + " (1 - x^2) \\dot x - x$";
+    else
+      return "x'' = " + m + "(1 - x^2) x' - x";
+  }
+};
+
+// Chemical reaction of Robertson, with the rate constants of very different
+// magnitudes.
+struct Robertson : Solver<Robertson> {
+
+  static constexpr auto t = TimeVariable();
+  static constexpr auto x = Variable<0>();
+  static constexpr auto y = Variable<1>();
+  static constexpr auto z = Variable<2>();
+
+  static const bool ic_is_true_solution = false;
+
+  auto get_rhs() {
+    return -0.04 * x + 1e4 * y * z |
+           0.04 * x - 1e4 * y * z - 3e7 * y * y | 3e7 * y * y;
+  }
+  auto get_ic() { return Constant(1.) | 0. | 0.; }
+
+  std::string repr(bool latex = true) {
+    if (latex)
+      return "$\\dot x = -0.04 x + 10^4 y z, \\dot y = 0.04 x - 10^4 y z - 3 "
+             "\\cdot 10^7 y^2, \\dot z = 3 \\cdot 10^7 y^2$";
+    else
+      return "x' = -0.04x + 1e4yz, y' = 0.04x - 1e4yz - 3e7y^2, z' = 3e7y^2";
+  }
+};
+
+} // namespace diffurch::equation
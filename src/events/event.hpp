@@ -1,6 +1,7 @@
 #pragma once
 
 #include "primitives.hpp"
+#include <algorithm>
 #include <type_traits>
 #include <utility>
 
@@ -39,6 +40,13 @@ public:
       this->set();
     } else if constexpr (is_setting_const_state) {
       this->set(state);
+    } else if constexpr (is_setting_non_const_state &&
+                         is_transforming_handler_v<SetHandler>) {
+      // the stored steps are transformed too, so no zero step is needed
+      this->set(state);
+      if constexpr (is_saving) {
+        this->save(state);
+      }
     } else if constexpr (is_setting_non_const_state) {
       state.make_zero_step();
       this->set(state);
@@ -47,6 +55,13 @@ public:
       }
     }
   }
+
+  // the largest delay used by any of the handlers
+  double max_delay() const {
+    return std::max({EventDetectionInterface<DetectHandler>::max_delay(),
+                     EventSaveInterface<SaveHandler>::max_delay(),
+                     EventSetInterface<SetHandler>::max_delay()});
+  }
 };
 
 #define EVENT_WITHOUT_DETECTION(EventName)                                     \
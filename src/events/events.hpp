@@ -1,9 +1,13 @@
 #pragma once
 
+#include "../statistics.hpp"
 #include "../util/type_traits.hpp"
 #include "event.hpp"
+#include <algorithm>
+#include <array>
 #include <limits>
 #include <tuple>
+#include <type_traits>
 
 namespace diffurch {
 
@@ -23,11 +27,29 @@ struct SimultaniousEvents {
                      const SimultaniousEvents<EventType, EventTypes2...> &se2)
       : event_tuple(std::tuple_cat(se1.event_tuple, se2.event_tuple)){};
 
+  // whether some of the events can change the state or the parameters of the
+  // equation (except by transforming handlers, see TransformingHandler)
+  static constexpr bool has_set_handlers =
+      ((!std::is_same_v<decltype(EventTypes::set), std::nullptr_t> &&
+        !is_transforming_handler_v<decltype(EventTypes::set)>) ||
+       ...);
+  // whether some of the events transform the state (and the stages K_curr)
+  static constexpr bool has_transforming_handlers =
+      (is_transforming_handler_v<decltype(EventTypes::set)> || ...);
+
   // run event(state) for all events in event_tuple
   void operator()(auto &state) {
     std::apply([&state](auto &&...events) { (events(state), ...); },
                event_tuple);
   }
+
+  double max_delay() const {
+    return std::apply(
+        [](const auto &...events) {
+          return std::max({0., events.max_delay()...});
+        },
+        event_tuple);
+  }
 };
 
 template <template <typename...> typename EventType, typename... EventTypes>
@@ -88,10 +110,15 @@ using filter_simultaneous_events_t =
         std::make_tuple(std::declval<EventTypes>()...)));
 
 template <typename... EventTypes> struct Events {
-  size_t located_event_index = -1;
-
   filter_events_t<Event, EventTypes...> detection_events;
 
+  // The events, that were located at the earliest time. Several events can be
+  // located at the same time (e.g. the zero crossing of the same expression),
+  // and they are all called, since after the first call the crossing would
+  // not be detected again.
+  std::array<bool, std::tuple_size_v<decltype(detection_events)>>
+      located_events{};
+
   filter_simultaneous_events_t<StepEvent, EventTypes...> step_events;
   filter_simultaneous_events_t<RejectEvent, EventTypes...> reject_events;
   filter_simultaneous_events_t<CallEvent, EventTypes...> call_events;
@@ -129,10 +156,14 @@ template <typename... EventTypes> struct Events {
     [&]<std::size_t... Is>(std::index_sequence<Is...>) {
       (
           [&state, &t_event, this](auto &&event, size_t index) {
+            state.count(&Statistics::locate_calls);
             double t = event.locate(state);
             if (t < t_event) {
               t_event = t;
-              located_event_index = index;
+              located_events.fill(false);
+              located_events[index] = true;
+            } else if (t == t_event && t < std::numeric_limits<double>::max()) {
+              located_events[index] = true;
             }
           }(std::get<Is>(detection_events), Is),
           ...);
@@ -142,18 +173,25 @@ template <typename... EventTypes> struct Events {
     return t_event;
   }
 
-  void located_event(auto &state) {
-    if (located_event_index == size_t(-1))
-      return;
+  // Keeps the located events, that are still detected after the step was
+  // redone to the event time. It is called before the step events, since
+  // they may make a zero step, after which nothing is detected.
+  void confirm_located(const auto &state) {
+    [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+      ((located_events[Is] =
+            located_events[Is] && std::get<Is>(detection_events).detect(state)),
+       ...);
+    }(std::make_index_sequence<
+        std::tuple_size_v<decltype(detection_events)>>{});
+  }
 
+  void located_event(auto &state) {
     [&]<std::size_t... Is>(std::index_sequence<Is...>) {
       (
           [&state, this](auto &&event, size_t index) {
-            if (index == located_event_index) {
-              if (event.detect(state)) // if event is still detected
-                event(state);
-              located_event_index = -1;
-              return;
+            if (located_events[index]) {
+              located_events[index] = false;
+              event(state);
             }
           }(std::get<Is>(detection_events), Is),
           ...);
@@ -161,6 +199,19 @@ template <typename... EventTypes> struct Events {
         std::tuple_size_v<decltype(detection_events)>>{});
   }
 
+  // the largest delay, with which the state is accessed in any of the events
+  double max_delay() const {
+    return std::max(
+        {std::apply(
+             [](const auto &...events) {
+               return std::max({0., events.max_delay()...});
+             },
+             detection_events),
+         step_events.max_delay(), reject_events.max_delay(),
+         call_events.max_delay(), start_events.max_delay(),
+         stop_events.max_delay()});
+  }
+
   auto get_saved() const {
     auto get_saved_from_tuple = [](const auto &tuple_) {
       return std::apply(
@@ -13,6 +13,7 @@ struct StopIntegration {
     state.t_prev = state.t_curr;
     state.t_curr = std::numeric_limits<double>::max();
   }
+  static constexpr double max_delay() { return 0.; }
 };
 
 // Special Save Handler to save current time and state variables
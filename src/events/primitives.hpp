@@ -1,11 +1,87 @@
 #pragma once
 
 #include "../symbolic/vector.hpp"
+#include <algorithm>
+#include <concepts>
+#include <limits>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 namespace diffurch {
+
+// Handlers that do not declare max_delay (e.g. lambdas) may evaluate the
+// whole past of the state, so the past steps are not discarded for them.
+double handler_max_delay(const auto &handler) {
+  if constexpr (requires { handler.max_delay(); })
+    return handler.max_delay();
+  else if constexpr (std::is_null_pointer_v<std::decay_t<decltype(handler)>>)
+    return 0.;
+  else
+    return std::numeric_limits<double>::infinity();
+}
+
+// The handler (e.g. a lambda), that evaluates the state only through the
+// symbol expr, so that it evaluates the past at most expr.max_delay() before
+// t_prev, e.g. `Event(When(x == 0.), nullptr,
+// handler_reading(x(t - 1.), [](auto &state) { ... }))`, or
+// `handler_reading(Variable<>(), handler)` for the handler of the current
+// step only.
+template <typename Expr, typename Handler> struct HandlerReading {
+  Expr expr;
+  Handler handler;
+
+  template <typename... Args>
+    requires std::invocable<Handler &, Args...>
+  decltype(auto) operator()(Args &&...args) {
+    return handler(std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+    requires std::invocable<const Handler &, Args...>
+  decltype(auto) operator()(Args &&...args) const {
+    return handler(std::forward<Args>(args)...);
+  }
+  double max_delay() const { return expr.max_delay(); }
+};
+template <typename Expr, typename Handler>
+HandlerReading<Expr, Handler> handler_reading(const Expr &expr,
+                                              const Handler &handler) {
+  return {expr, handler};
+}
+
+template <typename Expr, typename Handler>
+struct has_delayed_variable<HandlerReading<Expr, Handler>>
+    : has_delayed_variable<Expr> {};
+
+// The set handler, that changes the state only by State::transform with a
+// linear map, that commutes with the right hand side, e.g. the
+// renormalization of the tangent vectors of the variational equations (see
+// lyapunov.hpp), so that the transformed steps and stages are still the
+// solution. No zero step is made for it (see Event), and it does not count in
+// has_set_handlers, so the last stage is still reused by FSAL methods.
+template <typename Handler> struct TransformingHandler {
+  Handler handler;
+
+  template <typename... Args>
+    requires std::invocable<Handler &, Args...>
+  decltype(auto) operator()(Args &&...args) {
+    return handler(std::forward<Args>(args)...);
+  }
+  double max_delay() const { return handler_max_delay(handler); }
+};
+template <typename Handler>
+TransformingHandler<Handler> transforming_handler(const Handler &handler) {
+  return {handler};
+}
+
+template <typename T> struct is_transforming_handler : std::false_type {};
+template <typename Handler>
+struct is_transforming_handler<TransformingHandler<Handler>> : std::true_type {
+};
+template <typename T>
+inline constexpr bool is_transforming_handler_v =
+    is_transforming_handler<std::decay_t<T>>::value;
+
 template <typename SaveHandler = std::nullptr_t> struct EventSaveInterface {
 private:
   SaveHandler save_handler;
@@ -17,12 +93,14 @@ public:
   void save(const auto &state) {
     std::get<0>(saved).push_back(save_handler(state));
   }
+  double max_delay() const { return handler_max_delay(save_handler); }
 };
 
 template <> struct EventSaveInterface<std::nullptr_t> {
   EventSaveInterface(std::nullptr_t = nullptr) {};
   std::tuple<> saved;
   inline void save(const auto &state) {}
+  static constexpr double max_delay() { return 0.; }
 };
 
 template <typename... SaveHandlers>
@@ -46,6 +124,14 @@ public:
   void save(const auto &state) {
     save_impl(state, std::index_sequence_for<SaveHandlers...>{});
   }
+
+  double max_delay() const {
+    return std::apply(
+        [](const auto &...handlers) {
+          return std::max({0., handler_max_delay(handlers)...});
+        },
+        save_handlers);
+  }
 };
 
 template <typename... SaveHandlers>
@@ -59,6 +145,7 @@ struct EventSaveInterface<Vector<SaveHandlers...>>
 template <typename SetHandler = std::nullptr_t> struct EventSetInterface {
   SetHandler set;
   EventSetInterface(const SetHandler &set_) : set(set_) {};
+  double max_delay() const { return handler_max_delay(set); }
 };
 
 template <typename DetectionHandler = std::nullptr_t>
@@ -70,9 +157,11 @@ struct EventDetectionInterface {
 
   bool detect(const auto &state) { return detection_handler.detect(state); }
   double locate(const auto &state) { return detection_handler.locate(state); }
+  double max_delay() const { return handler_max_delay(detection_handler); }
 };
 
 template <> struct EventDetectionInterface<std::nullptr_t> {
   EventDetectionInterface(std::nullptr_t = nullptr) {}
+  static constexpr double max_delay() { return 0.; }
 };
 } // namespace diffurch
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "util/vec.hpp"
+
+#include "solver.hpp"
+#include "symbolic.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "rk_tables/rk98.hpp"
+
+namespace diffurch {
+
+// The initial condition of Variational for the initial functions, that are not
+// symbolic. The derivatives of the initial function are forwarded, if it
+// defines them (see State::eval), and the tangent vectors are constant.
+template <size_t n, size_t k, typename IC> struct VariationalIC {
+  IC ic;
+
+  Vec<n * (k + 1)> operator()(double t) const {
+    Vec<n * (k + 1)> x{};
+    Vec<n> x_ic = ic(t);
+    for (size_t j = 0; j < n; j++)
+      x[j] = x_ic[j];
+    for (size_t m = 0; m < k; m++)
+      x[n * (m + 1) + m] = 1.;
+    return x;
+  }
+
+  template <size_t derivative_order>
+    requires requires(const IC &ic, double t) {
+      ic.template eval<derivative_order>(t);
+    }
+  Vec<n * (k + 1)> eval(double t) const {
+    Vec<n * (k + 1)> x{};
+    Vec<n> x_ic = ic.template eval<derivative_order>(t);
+    for (size_t j = 0; j < n; j++)
+      x[j] = x_ic[j];
+    return x;
+  }
+};
+
+// The equation together with its variational equations for k tangent vectors
+// v_0, ..., v_{k-1}, which are the coordinates n (m + 1), ..., n (m + 2) - 1
+// of the system
+// x' = f(t, x, x(t - tau)),
+// v_m' = f_x v_m + f_{x(t - tau)} v_m(t - tau).
+// The right hand side of v_m is the derivative of f in the direction of v_m
+// (see Direction in symbolic/variables.hpp), so the delayed variables are
+// linearized too, and the tangent vectors jump at the switches of dsign and
+// dstep (see delta in symbolic/discontinuous.hpp). The initial tangent vectors
+// are the unit vectors e_m (also in the past, for delay equations).
+template <typename Equation, size_t k>
+struct Variational : Solver<Variational<Equation, k>> {
+  static constexpr size_t n =
+      std::tuple_size_v<decltype(std::declval<Equation &>().get_ic()(0.))>;
+  static_assert(k <= n, "the tangent vectors are compared by their current "
+                        "values, so there can be at most n of them");
+
+  Equation equation;
+
+  Variational(const Equation &equation_) : equation(equation_) {}
+
+  auto get_rhs() {
+    auto rhs = equation.get_rhs();
+    return [&]<size_t... m>(std::index_sequence<m...>) {
+      return Vector(std::tuple_cat(
+          rhs.coordinates,
+          partial<Direction<n * (m + 1)>>(rhs).coordinates...));
+    }(std::make_index_sequence<k>{});
+  }
+
+  auto get_ic() {
+    auto ic = equation.get_ic();
+    if constexpr (IsSymbol<decltype(ic)>) {
+      return [&]<size_t... i>(std::index_sequence<i...>) {
+        return Vector(std::tuple_cat(
+            ic.coordinates,
+            std::make_tuple(Constant(i / n == i % n ? 1. : 0.)...)));
+      }(std::make_index_sequence<n * k>{});
+    } else {
+      return VariationalIC<n, k, decltype(ic)>{ic};
+    }
+  }
+
+  auto get_events() { return equation.get_events(); }
+};
+
+// The k largest Lyapunov exponents of the equation, i.e. the average rates of
+// growth of the volumes, spanned by k tangent vectors, on the solution from
+// initial_time to final_time. The variational equations (see Variational) are
+// integrated with the solution, and after each step the tangent vectors are
+// orthonormalized by the Gram-Schmidt process (the QR decomposition), and the
+// logarithms of the diagonal of R are summed. For delay equations, the
+// tangent vectors are orthonormalized with their past (see State::transform),
+// after the initial function is no longer evaluated, and they are compared by
+// their current values only, so the largest exponent is the most reliable.
+template <size_t k, typename RK = rk98, typename History = StepHistory,
+          typename Equation, typename StepsizeControllerT = ConstantStepsize>
+std::array<double, k> lyapunov_exponents(
+    const Equation &equation, double initial_time, double final_time,
+    StepsizeControllerT stepsize_controller = ConstantStepsize(0.01)) {
+  static constexpr size_t n = Variational<Equation, k>::n;
+
+  Variational<Equation, k> variational(equation);
+  // the initial function is evaluated by the right hand side until
+  // initial_time + max_delay, and it is not orthonormalized with the past
+  double max_delay = variational.get_rhs().max_delay();
+  if (std::isinf(max_delay)) {
+    std::cerr << "diffurch: lyapunov_exponents requires the bounded delays, "
+                 "so that the initial function is no longer evaluated after "
+                 "some time"
+              << std::endl;
+    std::abort();
+  }
+
+  std::array<double, k> log_growth{};
+  auto orthonormalize_handler = [&log_growth, max_delay](auto &state) {
+    if (state.t_curr - max_delay < state.t_init)
+      return;
+
+    // v_m = sum_{l <= m} R[l][m] q_l for the orthonormal q_l
+    std::array<std::array<double, k>, k> R{};
+    std::array<Vec<n>, k> q;
+    for (size_t m = 0; m < k; m++) {
+      for (size_t j = 0; j < n; j++)
+        q[m][j] = state.x_curr[n * (m + 1) + j];
+      for (size_t l = 0; l < m; l++) {
+        for (size_t j = 0; j < n; j++)
+          R[l][m] += q[l][j] * q[m][j];
+        for (size_t j = 0; j < n; j++)
+          q[m][j] -= R[l][m] * q[l][j];
+      }
+      R[m][m] = norm(q[m]);
+      for (size_t j = 0; j < n; j++)
+        q[m][j] /= R[m][m];
+      log_growth[m] += std::log(R[m][m]);
+    }
+
+    // v_m is replaced with q_m, i.e. the tangent vectors are multiplied by
+    // the inverse of R, also in the past
+    state.transform([&R](auto x) {
+      for (size_t m = 0; m < k; m++) {
+        for (size_t j = 0; j < n; j++) {
+          double &v = x[n * (m + 1) + j];
+          for (size_t l = 0; l < m; l++)
+            v -= R[l][m] * x[n * (l + 1) + j];
+          v /= R[m][m];
+        }
+      }
+      return x;
+    });
+  };
+  // the handler reads only the current step, and transforms the stored ones,
+  // so no zero step is made, and the last stage is reused by FSAL methods
+  auto orthonormalize = StepEvent(
+      nullptr, transforming_handler(
+                   handler_reading(Variable<>(), orthonormalize_handler)));
+
+  variational.template solution<RK, History>(initial_time, final_time,
+                                             stepsize_controller,
+                                             std::make_tuple(orthonormalize));
+  for (double &exponent : log_growth)
+    exponent /= final_time - initial_time;
+  return log_growth;
+}
+
+} // namespace diffurch
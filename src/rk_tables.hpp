@@ -4,3 +4,4 @@
 #include "rk_tables/rk4.hpp"
 #include "rk_tables/rk98.hpp"
 #include "rk_tables/rktp64.hpp"
+#include "rk_tables/rosenbrock23.hpp"
@@ -10,6 +10,8 @@ struct dp54 {
   constexpr static size_t order = 5;
   constexpr static size_t order_embedded = 4;
   constexpr static size_t order_interpolation = 4;
+  // the last stage is evaluated at the end of the step (see is_fsal_v)
+  constexpr static bool fsal = true;
 
   constexpr static std::array<std::array<double, s - 1>, s> a{
       {{},
@@ -24,7 +26,7 @@ struct dp54 {
         9.82289285169943606157597927145252248132906569120560,
         -0.29080932784636488340192043895747599451303155006859},
        {2.84627525252525252525252525252525252525252525252530,
-        10.75757575757575757575757575757575757575757575757600,
+        -10.75757575757575757575757575757575757575757575757600,
         8.90642271774347246045359252906422717743472460453590,
         0.27840909090909090909090909090909090909090909090909,
         -0.27353130360205831903945111492281303602058319039451},
@@ -61,43 +63,38 @@ struct dp54 {
        0.08904761904761904761904761904761904761904761904762,
        0.02500000000000000000000000000000000000000000000000}};
 
-  constexpr static std::array<Polynomial<5>, s> bs{
+  // continuous extension of order 4 by Shampine (as in DOPRI5 by Hairer)
+  constexpr static std::array<Polynomial<4>, s> bs{
       {{0.00000000000000000000000000000000000000000000000000,
         1.00000000000000000000000000000000000000000000000000,
-        -2.86053866903708863097943370885663105213518085381780,
-        3.09957787870912092268605753792811855250234711279230,
-        -1.16181058364030928576714728261967728193248499746470,
-        0.01391720730161032739385678688152311489865207182347},
+        -2.85358006538628346728250531541586949468585481790601,
+        3.07174346410590026789834396416507232270504296914536,
+        -1.12701756538628346728250531541586949468585481790601},
        {},
        {0.00000000000000000000000000000000000000000000000000,
         0.00000000000000000000000000000000000000000000000000,
-        4.04714149964278557319049904942449527421302289187800,
-        -6.34535404693892573505342403022818979479695679525830,
-        2.79546508641400508297021164893042296731423395351700,
-        -0.04801624082496285462031452077722260665842224240982},
+        4.02313337923030414588034178903588397088381177067304,
+        -6.24932156528900002581279498867374458148011231043862,
+        2.67542448435159794641942534698736645066817834749245},
        {0.00000000000000000000000000000000000000000000000000,
         0.00000000000000000000000000000000000000000000000000,
-        7.84741007111265892938301126569893156405542561453250,
-        -13.50816969460696101391505947117688990840374671710300,
-        6.72931750920927857301441847859031845797454992394090,
-        -0.41751621904830982181570360644569344695956215470417},
+        -3.73240196158850401847515946247608484057564453718042,
+        10.06897058984367470361698559161883634781795574102751,
+        -5.68552696158850401847515946247608484057564453718042},
        {0.00000000000000000000000000000000000000000000000000,
         0.00000000000000000000000000000000000000000000000000,
-        2.84194470158703464060417964659343605697434957168720,
-        -7.54767586295938599838505349903387310042704029578820,
-        4.95763672493125298061794541677800406766688093311860,
-        -0.57428174280418464170499609263945381666702039769687},
+        2.55480383018494231975168160027370914864083937283873,
+        -6.39911237735101671497506131375496546709299950039444,
+        3.52193236792079137635545518517936952599932993887647},
        {0.00000000000000000000000000000000000000000000000000,
         0.00000000000000000000000000000000000000000000000000,
-        2.39670292163108553124449083469142506413685252737370,
-        -4.74272536284904180356196142354156484858415188009150,
-        2.95010386556673177529521224777075926666250808282390,
-        -0.47312904339639455059678927796823852983425634915370},
+        -1.37442411421860254166038190999302008493401006708252,
+        3.27265775224672889284457334379556397939182965797457,
+        -1.76728125707574539880323905285016294207686720993966},
        {0.00000000000000000000000000000000000000000000000000,
         0.00000000000000000000000000000000000000000000000000,
-        1.52360049411133393144135467348444915173617479911710,
-        -4.32946547433983506636374840484767697183937753380880,
-        3.08812946634566833840343278924200648847023067026640,
-        -0.28226448611716720348103905787877866836702793557465}}};
+        1.38246893177814356178602329857538130067085827865719,
+        -3.76493786355628712357204659715076260134171655731437,
+        2.38246893177814356178602329857538130067085827865719}}};
 };
 } // namespace diffurch
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../util/polynomial.hpp"
+#include <array>
+
+namespace diffurch {
+// Rosenbrock method of order 2 with the error estimate of order 3 by Shampine
+// and Reichelt (the method of ode23s in MATLAB), for stiff equations. The
+// solution of order 2 does not depend on the Jacobian being exact (it is a
+// W-method), and it is L-stable. With d = 1 / (2 + sqrt(2)), the stages are
+// (I - h d J) K_0 = f_0 + h d f_t,
+// (I - h d J) (K_1 - K_0) = f_1 - K_0,
+// (I - h d J) K_2 = f_2 - (6 + sqrt(2)) (K_1 - f_1) - 2 (K_0 - f_0) + h d f_t,
+// where f_i are the values of the right hand side at the stages, J and f_t
+// are its partial derivatives at the beginning of the step (see
+// rosenbrock.hpp for the general form).
+struct rosenbrock23 {
+
+  constexpr static size_t s = 3;
+  constexpr static size_t order = 2;
+  constexpr static size_t order_embedded = 3;
+  constexpr static size_t order_interpolation = 2;
+  // the last stage is evaluated at the end of the step (see is_fsal_v)
+  constexpr static bool fsal = true;
+  // the Jacobian is kept over the steps (see is_w_method_v)
+  constexpr static bool w_method = true;
+
+  constexpr static std::array<std::array<double, s - 1>, s> a{
+      {{}, {0.5}, {0.0, 1.0}}};
+
+  constexpr static std::array<double, s> c{{0.0, 0.5, 1.0}};
+
+  constexpr static std::array<double, s> b{{0.0, 1.0, 0.0}};
+
+  constexpr static std::array<double, s> bb{
+      {-0.16666666666666666666666666666666666666666666666667,
+       1.33333333333333333333333333333333333333333333333333,
+       -0.16666666666666666666666666666666666666666666666667}};
+
+  constexpr static std::array<double, s> e{
+      {0.16666666666666666666666666666666666666666666666667,
+       -0.33333333333333333333333333333333333333333333333333,
+       0.16666666666666666666666666666666666666666666666667}};
+
+  // the diagonal gamma_ii = d, and gamma_ij for j < i
+  constexpr static double gamma =
+      0.29289321881345247559915563789515096071516406231153;
+  constexpr static std::array<std::array<double, s - 1>, s> gamma_lower{
+      {{},
+       {-0.29289321881345247559915563789515096071516406231153},
+       {1.58578643762690495119831127579030192143032812462306,
+        -2.17157287525380990239662255158060384286065624924612}}};
+
+  constexpr static std::array<Polynomial<2>, s> bs{
+      {{0.00000000000000000000000000000000000000000000000000,
+        2.41421356237309504880168872420969807856967187537694,
+        -2.41421356237309504880168872420969807856967187537694},
+       {0.00000000000000000000000000000000000000000000000000,
+        -1.41421356237309504880168872420969807856967187537694,
+        2.41421356237309504880168872420969807856967187537694},
+       {0.00000000000000000000000000000000000000000000000000,
+        0.00000000000000000000000000000000000000000000000000,
+        0.00000000000000000000000000000000000000000000000000}}};
+};
+} // namespace diffurch
@@ -0,0 +1,207 @@
+#pragma once
+#include "util/lu.hpp"
+#include "util/vec.hpp"
+
+#include "statistics.hpp"
+#include "symbolic.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+namespace diffurch {
+
+// Whether the table is a Rosenbrock method, i.e. it declares the coefficients
+// gamma and gamma_lower of the Jacobian (see rk_tables/rosenbrock23.hpp).
+template <typename RK>
+constexpr bool is_rosenbrock_v = requires {
+  RK::gamma;
+  RK::gamma_lower;
+};
+
+// Whether the Rosenbrock method is a W-method, i.e. it has its order with any
+// matrix in place of the Jacobian, so that the Jacobian can be kept over the
+// steps (see RosenbrockStages::factorize).
+template <typename RK>
+constexpr bool is_w_method_v = requires { requires RK::w_method; };
+
+// The stages K_i of Rosenbrock methods are defined by
+// (I - h gamma J) K_i = f(t + c_i h, x + h sum_{j<i} a_ij K_j)
+//                     + h J sum_{j<i} gamma_ij K_j + h gamma_i f_t,
+// where J and f_t are the partial derivatives of the right hand side with
+// respect to x and t at the beginning of the step, and gamma_i is the sum of
+// gamma_ij for j <= i (with gamma_ii = gamma). As in Hairer and Wanner
+// (Solving Ordinary Differential Equations II, IV.7), they are computed with
+// u_i = sum_{j<=i} gamma_ij K_j, for which
+// (I - h gamma J) u_i = gamma (f_i + sum_{j<i} C_ij u_j + h gamma_i f_t),
+// K_i = u_i / gamma - sum_{j<i} C_ij u_j,
+// where C = -Gamma^{-1} below the diagonal, so the products with J are not
+// computed. The stages K_i are the same as for explicit methods otherwise
+// (with the weights a, b, bb, and bs for the dense output).
+template <typename RK> constexpr auto rosenbrock_c() {
+  std::array<std::array<double, RK::s>, RK::s> inverse{};
+  std::array<std::array<double, RK::s - 1>, RK::s> C{};
+  for (size_t i = 0; i < RK::s; i++) {
+    inverse[i][i] = 1. / RK::gamma;
+    for (size_t j = 0; j < i; j++) {
+      double sum = 0.;
+      for (size_t k = j; k < i; k++)
+        sum += RK::gamma_lower[i][k] * inverse[k][j];
+      inverse[i][j] = -sum / RK::gamma;
+      C[i][j] = -inverse[i][j];
+    }
+  }
+  return C;
+}
+template <typename RK>
+constexpr std::array<std::array<double, RK::s - 1>, RK::s> rosenbrock_c_v =
+    rosenbrock_c<RK>();
+
+template <typename RK> constexpr auto rosenbrock_gamma_sums() {
+  std::array<double, RK::s> gamma_sums{};
+  for (size_t i = 0; i < RK::s; i++) {
+    gamma_sums[i] = RK::gamma;
+    for (size_t j = 0; j < i; j++)
+      gamma_sums[i] += RK::gamma_lower[i][j];
+  }
+  return gamma_sums;
+}
+
+// Linear algebra of the stages of Rosenbrock method RK for the system of n
+// equations, with the symbolic Jacobian and time derivative of the right hand
+// side. For W-methods, the Jacobian and the LU decomposition of
+// I - h gamma J are kept over the steps: while the stepsize is not reduced,
+// nor increased more than max_stepsize_ratio times, the step is made with the
+// factorized stepsize (so the controller of the stepsize can only increase it
+// by the larger factor), and the Jacobian is reevaluated after
+// max_jacobian_age steps. Otherwise, the Jacobian is evaluated once per step,
+// and is reused for the rejected steps and for the steps redone to the event
+// time. The LU decomposition is reused while the stepsize and the Jacobian do
+// not change (e.g. for linear equations with constant stepsize). The time
+// derivative is evaluated in every step.
+template <typename RK, size_t n, typename JacobianT, typename TimeDerivativeT>
+struct RosenbrockStages {
+  static constexpr std::array<double, RK::s> gamma_sums =
+      rosenbrock_gamma_sums<RK>();
+  static constexpr double max_stepsize_ratio = 1.5;
+  static constexpr size_t max_jacobian_age = 20;
+
+  JacobianT jacobian_expression;
+  TimeDerivativeT time_derivative_expression;
+  // the factors repeated by the product rule are evaluated once
+  SharedSubexpressions<JacobianT> shared_jacobian;
+  SharedSubexpressions<TimeDerivativeT> shared_time_derivative;
+
+  // the values of the right hand side at the stages
+  std::array<Vec<n>, RK::s> F;
+  std::array<Vec<n>, RK::s> u;
+
+  Mat<n> jacobian{};
+  Vec<n> time_derivative;
+  // the point, at which the time derivative is evaluated, and whether the
+  // Jacobian is evaluated there, or the number of the steps since it is
+  double t_derivatives = std::numeric_limits<double>::quiet_NaN();
+  Vec<n> x_derivatives;
+  bool jacobian_is_current = false;
+  size_t jacobian_age = 0;
+
+  Mat<n> LU;
+  std::array<size_t, n> pivots;
+  double factorized_t_step = std::numeric_limits<double>::quiet_NaN();
+
+  RosenbrockStages(JacobianT jacobian_expression_,
+                   TimeDerivativeT time_derivative_expression_)
+      : jacobian_expression(jacobian_expression_),
+        time_derivative_expression(time_derivative_expression_),
+        shared_jacobian(jacobian_expression),
+        shared_time_derivative(time_derivative_expression) {}
+
+  // The Jacobian at (t_prev, x_prev) and the decomposition for t_step, that
+  // is called before the stages of the step, and can shorten it (see above).
+  // Returns false, if I - h gamma J is singular, so that the step can not be
+  // made with this stepsize.
+  bool factorize(auto &state) {
+    state.t_curr = state.t_prev;
+    state.x_curr = state.x_prev;
+    if (!(state.t_prev == t_derivatives && state.x_prev == x_derivatives)) {
+      time_derivative =
+          shared_time_derivative(time_derivative_expression, state);
+      t_derivatives = state.t_prev;
+      x_derivatives = state.x_prev;
+      jacobian_is_current = false;
+      jacobian_age++;
+    }
+
+    bool keep_jacobian = false;
+    if constexpr (is_w_method_v<RK>)
+      keep_jacobian = jacobian_age < max_jacobian_age &&
+                      state.t_step >= factorized_t_step &&
+                      state.t_step <= max_stepsize_ratio * factorized_t_step;
+
+    if (keep_jacobian) {
+      state.t_step = factorized_t_step;
+      return true;
+    }
+
+    if (!jacobian_is_current) {
+      Mat<n> new_jacobian = shared_jacobian(jacobian_expression, state);
+      state.count(&Statistics::jacobian_evaluations);
+      jacobian_is_current = true;
+      jacobian_age = 0;
+      if (new_jacobian != jacobian) {
+        jacobian = new_jacobian;
+        factorized_t_step = std::numeric_limits<double>::quiet_NaN();
+      }
+    }
+
+    if (state.t_step != factorized_t_step) {
+      double h_gamma = state.t_step * RK::gamma;
+      for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+          LU[i][j] = (i == j) - h_gamma * jacobian[i][j];
+      state.count(&Statistics::lu_decompositions);
+      if (!lu_decompose(LU, pivots)) {
+        factorized_t_step = std::numeric_limits<double>::quiet_NaN();
+        return false;
+      }
+      factorized_t_step = state.t_step;
+    }
+    return true;
+  }
+
+  // The Jacobian is reevaluated in the next step, e.g. after the events,
+  // that can change the right hand side, or the stepsize.
+  void discard_jacobian() { jacobian_age = max_jacobian_age; }
+
+  // The stage K_i from the value F[i] of the right hand side.
+  template <size_t i> void stage(auto &state) {
+    Vec<n> sum = dot<rosenbrock_c_v<RK>[i], i>(u);
+    Vec<n> rhs = F[i] + sum;
+    if constexpr (gamma_sums[i] != 0.)
+      rhs = rhs + (state.t_step * gamma_sums[i]) * time_derivative;
+    u[i] = RK::gamma * lu_solve(LU, pivots, rhs);
+    state.K_curr[i] = (1. / RK::gamma) * u[i] - sum;
+  }
+};
+
+// The error for the step, that can not be made, because I - h gamma J is
+// singular, and the stepsize can not be reduced (with the constant stepsize,
+// at min_stepsize, or in the step redone to the event time).
+[[noreturn]] inline void singular_rosenbrock_step(double t, double h) {
+  std::cerr << "diffurch: I - h gamma J of the Rosenbrock method is singular "
+               "at t = "
+            << t << " for h = " << h << std::endl;
+  std::abort();
+}
+
+template <typename RK, size_t n, typename Rhs>
+auto rosenbrock_stages(const Rhs &rhs) {
+  auto jacobian_expression = jacobian(rhs);
+  auto time_derivative_expression = partial<TimeVariable>(rhs);
+  return RosenbrockStages<RK, n, decltype(jacobian_expression),
+                          decltype(time_derivative_expression)>(
+      jacobian_expression, time_derivative_expression);
+}
+
+} // namespace diffurch
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "runtime/bytecode.hpp"
+#include "runtime/equation.hpp"
+#include "runtime/expression.hpp"
+#include "runtime/parser.hpp"
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace diffurch {
+
+// Expressions, that are defined at runtime, are compiled to the bytecode of a
+// register machine. The registers are
+// - 0: time t,
+// - 1, ..., variables: the coordinates of the state x_0, ..., x_{variables-1},
+// - then the constants and the parameters (which can be changed without
+//   rebuilding the bytecode, see RuntimeExpression::set_parameter),
+// - then the results of the instructions, one register per instruction.
+// Each instruction reads registers a and b (only a for the functions of one
+// argument), and writes the register result. The delayed variables are the
+// instructions Lag and LagDerivative, which evaluate the coordinate b (or its
+// derivative) of the state at time a, as VariableAt in symbolic/variables.hpp.
+enum class OpCode : uint8_t {
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Neg,
+  Pow,
+  Atan2,
+  Sin,
+  Cos,
+  Tan,
+  Exp,
+  Log,
+  Sqrt,
+  Abs,
+  Sign,
+  Lag,
+  LagDerivative,
+};
+
+struct Instruction {
+  OpCode op;
+  uint32_t result;
+  uint32_t a;
+  uint32_t b;
+};
+
+// whether the instruction reads register b, and not only a
+inline bool is_binary(OpCode op) {
+  return op == OpCode::Add || op == OpCode::Sub || op == OpCode::Mul ||
+         op == OpCode::Div || op == OpCode::Pow || op == OpCode::Atan2;
+}
+
+// the value of the instruction, which is not Lag or LagDerivative
+inline double apply(OpCode op, double a, double b) {
+  switch (op) {
+  case OpCode::Add:
+    return a + b;
+  case OpCode::Sub:
+    return a - b;
+  case OpCode::Mul:
+    return a * b;
+  case OpCode::Div:
+    return a / b;
+  case OpCode::Neg:
+    return -a;
+  case OpCode::Pow:
+    // the exponents 2 and -1 by the arithmetic, as the compiler replaces pow
+    // with them, when they are constants in the native code (see
+    // opcode_expression), so that the values are the same
+    return b == 2. ? a * a : b == -1. ? 1. / a : std::pow(a, b);
+  case OpCode::Atan2:
+    return std::atan2(a, b);
+  case OpCode::Sin:
+    return std::sin(a);
+  case OpCode::Cos:
+    return std::cos(a);
+  case OpCode::Tan:
+    return std::tan(a);
+  case OpCode::Exp:
+    return std::exp(a);
+  case OpCode::Log:
+    return std::log(a);
+  case OpCode::Sqrt:
+    return std::sqrt(a);
+  case OpCode::Abs:
+    return std::abs(a);
+  case OpCode::Sign:
+    return double(a > 0.) - double(a < 0.);
+  default:
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+}
+
+// the name of the operation, as in the enum (the switch has no default, so
+// that the compiler warns about the operation, which is not named)
+inline const char *opcode_name(OpCode op) {
+  switch (op) {
+  case OpCode::Add:
+    return "Add";
+  case OpCode::Sub:
+    return "Sub";
+  case OpCode::Mul:
+    return "Mul";
+  case OpCode::Div:
+    return "Div";
+  case OpCode::Neg:
+    return "Neg";
+  case OpCode::Pow:
+    return "Pow";
+  case OpCode::Atan2:
+    return "Atan2";
+  case OpCode::Sin:
+    return "Sin";
+  case OpCode::Cos:
+    return "Cos";
+  case OpCode::Tan:
+    return "Tan";
+  case OpCode::Exp:
+    return "Exp";
+  case OpCode::Log:
+    return "Log";
+  case OpCode::Sqrt:
+    return "Sqrt";
+  case OpCode::Abs:
+    return "Abs";
+  case OpCode::Sign:
+    return "Sign";
+  case OpCode::Lag:
+    return "Lag";
+  case OpCode::LagDerivative:
+    return "LagDerivative";
+  }
+  return "";
+}
+
+// the C++ expression of the instruction, which is not Lag or LagDerivative,
+// with the operands a and b, that computes the same value as apply (see
+// jit.hpp). The switch has no default, as in opcode_name.
+inline std::string opcode_expression(OpCode op, const std::string &a,
+                                     const std::string &b) {
+  switch (op) {
+  case OpCode::Add:
+    return a + " + " + b;
+  case OpCode::Sub:
+    return a + " - " + b;
+  case OpCode::Mul:
+    return a + " * " + b;
+  case OpCode::Div:
+    return a + " / " + b;
+  case OpCode::Neg:
+    return "-(" + a + ")";
+  case OpCode::Pow:
+    return b + " == 2. ? " + a + " * " + a + " : " + b + " == -1. ? 1. / " +
+           a + " : std::pow(" + a + ", " + b + ")";
+  case OpCode::Atan2:
+    return "std::atan2(" + a + ", " + b + ")";
+  case OpCode::Sin:
+    return "std::sin(" + a + ")";
+  case OpCode::Cos:
+    return "std::cos(" + a + ")";
+  case OpCode::Tan:
+    return "std::tan(" + a + ")";
+  case OpCode::Exp:
+    return "std::exp(" + a + ")";
+  case OpCode::Log:
+    return "std::log(" + a + ")";
+  case OpCode::Sqrt:
+    return "std::sqrt(" + a + ")";
+  case OpCode::Abs:
+    return "std::abs(" + a + ")";
+  case OpCode::Sign:
+    return "double(" + a + " > 0.) - double(" + a + " < 0.)";
+  case OpCode::Lag:
+  case OpCode::LagDerivative:
+    return "std::numeric_limits<double>::quiet_NaN()";
+  }
+  return "";
+}
+
+struct Bytecode {
+  size_t variables = 0;
+  std::vector<Instruction> code;
+  // the initial values of the registers from 1 + variables, i.e. of the
+  // constants and parameters
+  std::vector<double> constants;
+  std::vector<std::pair<std::string, uint32_t>> parameters;
+  std::vector<uint32_t> outputs;
+  // for each delayed variable, the register of its delay, if its argument is
+  // `t - delay`, or no_register, if the delay is not known (e.g. it depends
+  // on the state)
+  std::vector<uint32_t> delays;
+  // whether the state is read, i.e. the expression is not a function of time
+  bool reads_state = false;
+  // the description of the error, if the bytecode was not built (e.g. the
+  // string was not parsed, see parse_expressions)
+  std::string error;
+
+  static constexpr uint32_t no_register = uint32_t(-1);
+
+  size_t registers() const {
+    return 1 + variables + constants.size() + code.size();
+  }
+};
+
+// Builds the bytecode from the operations, each of which returns the register
+// of its result. The identical instructions are built once, and the
+// instructions with constant arguments are evaluated (but not the ones with
+// parameters).
+class BytecodeBuilder {
+  Bytecode bytecode;
+  std::vector<bool> is_constant; // for the registers of constants
+  // by the bits of the value, so that nan is found, and -0 is not 0
+  std::map<uint64_t, uint32_t> constant_registers;
+  std::map<std::tuple<OpCode, uint32_t, uint32_t>, uint32_t> built;
+
+  // The registers of the results of instructions are assigned after all
+  // constants are known, so until build(), they are numbered from
+  // temporary_base.
+  static constexpr uint32_t temporary_base = uint32_t(1) << 31;
+
+  uint32_t first_constant() const { return 1 + bytecode.variables; }
+  bool is_folded(uint32_t reg) const {
+    return reg >= first_constant() && reg < temporary_base &&
+           is_constant[reg - first_constant()];
+  }
+  double constant_value(uint32_t reg) const {
+    return bytecode.constants[reg - first_constant()];
+  }
+  // the instruction, whose result is reg, if any
+  const Instruction *definition(uint32_t reg) const {
+    if (reg < temporary_base)
+      return nullptr;
+    return &bytecode.code[reg - temporary_base];
+  }
+  uint32_t instruction(OpCode op, uint32_t a, uint32_t b) {
+    auto [it, inserted] = built.try_emplace(
+        std::make_tuple(op, a, b),
+        temporary_base + uint32_t(bytecode.code.size()));
+    if (inserted)
+      bytecode.code.push_back(Instruction{op, it->second, a, b});
+    return it->second;
+  }
+
+public:
+  BytecodeBuilder(size_t variables) { bytecode.variables = variables; }
+
+  uint32_t time() { return 0; }
+  uint32_t variable(size_t coordinate) {
+    assert(coordinate < bytecode.variables);
+    bytecode.reads_state = true;
+    return 1 + coordinate;
+  }
+  uint32_t constant(double value) {
+    auto [it, inserted] = constant_registers.try_emplace(
+        std::bit_cast<uint64_t>(value),
+        first_constant() + bytecode.constants.size());
+    if (inserted) {
+      bytecode.constants.push_back(value);
+      is_constant.push_back(true);
+    }
+    return it->second;
+  }
+  uint32_t parameter(const std::string &name, double value) {
+    for (const auto &[parameter_name, reg] : bytecode.parameters)
+      if (parameter_name == name)
+        return reg;
+    uint32_t reg = first_constant() + bytecode.constants.size();
+    bytecode.constants.push_back(value);
+    is_constant.push_back(false);
+    bytecode.parameters.emplace_back(name, reg);
+    return reg;
+  }
+
+  uint32_t apply(OpCode op, uint32_t a, uint32_t b = 0) {
+    bool is_unary = !is_binary(op);
+    if (is_unary)
+      b = 0;
+    if (is_folded(a) && (is_unary || is_folded(b)))
+      return constant(diffurch::apply(op, constant_value(a),
+                                      is_unary ? 0. : constant_value(b)));
+    return instruction(op, a, b);
+  }
+
+  // the delayed variable x_coordinate(argument), or its derivative
+  uint32_t lag(size_t coordinate, uint32_t argument, bool derivative = false) {
+    assert(coordinate < bytecode.variables);
+    bytecode.reads_state = true;
+    uint32_t delay = Bytecode::no_register;
+    if (argument == time()) {
+      delay = constant(0.);
+    } else if (const Instruction *sub = definition(argument);
+               sub && sub->op == OpCode::Sub && sub->a == time() &&
+               sub->b >= first_constant() && sub->b < temporary_base) {
+      delay = sub->b;
+    }
+    size_t instructions = bytecode.code.size();
+    uint32_t reg =
+        instruction(derivative ? OpCode::LagDerivative : OpCode::Lag, argument,
+                    uint32_t(coordinate));
+    // the delay is kept once for the delayed variable, that is built once
+    if (bytecode.code.size() > instructions)
+      bytecode.delays.push_back(delay);
+    return reg;
+  }
+
+  void output(uint32_t reg) { bytecode.outputs.push_back(reg); }
+
+  Bytecode build() && {
+    // the temporary registers are moved after the constants
+    uint32_t first_result = first_constant() + bytecode.constants.size();
+    auto relocate = [&](uint32_t &reg) {
+      if (reg >= temporary_base)
+        reg = first_result + (reg - temporary_base);
+    };
+    for (auto &instruction : bytecode.code) {
+      relocate(instruction.result);
+      relocate(instruction.a);
+      if (instruction.op != OpCode::Lag &&
+          instruction.op != OpCode::LagDerivative)
+        relocate(instruction.b);
+    }
+    for (auto &reg : bytecode.outputs)
+      relocate(reg);
+    return std::move(bytecode);
+  }
+};
+
+} // namespace diffurch
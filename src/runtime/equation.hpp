@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../util/vec.hpp"
+
+#include "../solver.hpp"
+#include "expression.hpp"
+#include "parser.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace diffurch {
+
+// The equation of dimension n, whose right hand side and initial condition
+// are defined at runtime by the strings, e.g.
+// RuntimeEquation<1>({"x"}, {"-a * x + x(t - tau)"}, {"cos(t)"},
+//                    {{"a", 1.}, {"tau", 1.}})
+// (see parse_expressions in parser.hpp for the syntax). The initial condition
+// depends only on t. Only n is fixed at compile time, so one instantiation of
+// the solver integrates any equation of that dimension, and the parameters
+// are changed without parsing the strings again (see set_parameter). If the
+// strings are not parsed, error is not empty, and the equation is not solved.
+// The switches of sign are not located (see ExpressionParser), so the
+// discontinuous equations are solved with the accuracy of the steps over them.
+template <size_t n> struct RuntimeEquation : Solver<RuntimeEquation<n>> {
+  // the description of the first error of parsing, or empty
+  std::string error;
+  RuntimeExpression<Vec<n>> rhs;
+  RuntimeExpression<Vec<n>> ic;
+
+  RuntimeEquation(const std::array<std::string, n> &variables,
+                  const std::array<std::string, n> &rhs_,
+                  const std::array<std::string, n> &ic_,
+                  const std::map<std::string, double> &parameters = {})
+      : rhs(checked(parse_expressions({rhs_.begin(), rhs_.end()},
+                                      {variables.begin(), variables.end()},
+                                      parameters))),
+        ic(checked(parse_expressions({ic_.begin(), ic_.end()}, {},
+                                     parameters))) {}
+
+  // Sets the value of the parameter in the right hand side and in the initial
+  // condition, and returns false, if neither has the parameter.
+  bool set_parameter(const std::string &name, double value) {
+    bool in_rhs = rhs.set_parameter(name, value);
+    bool in_ic = ic.set_parameter(name, value);
+    return in_rhs || in_ic;
+  }
+
+  auto get_rhs() {
+    if (!error.empty()) {
+      std::cerr << "diffurch: the strings of RuntimeEquation were not parsed: "
+                << error << std::endl;
+      std::abort();
+    }
+    return rhs;
+  }
+  // The initial condition is not a symbol, so its derivative (for neutral
+  // equations) is approximated, see BackwardDifference.
+  auto get_ic() {
+    return BackwardDifference{[ic = ic](double t) { return ic(t); }};
+  }
+
+private:
+  // the bytecode with the error is replaced with the bytecode of zeros, so
+  // that the expressions are constructed, and the error is kept in error (the
+  // equation is not solved then, see get_rhs)
+  Bytecode checked(Bytecode bytecode) {
+    if (bytecode.error.empty())
+      return bytecode;
+    if (error.empty())
+      error = bytecode.error;
+    BytecodeBuilder builder(bytecode.variables);
+    for (size_t i = 0; i < n; i++)
+      builder.output(builder.constant(0.));
+    return std::move(builder).build();
+  }
+};
+
+} // namespace diffurch
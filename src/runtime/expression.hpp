@@ -0,0 +1,227 @@
+#pragma once
+
+#include "../symbolic/symbol_types.hpp"
+#include "../symbolic/variables.hpp"
+#include "bytecode.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace diffurch {
+
+// The native code of the bytecode, see jit.hpp. The compiled function
+// evaluates the outputs of the bytecode at time t and state x (null if the
+// bytecode does not read the state), with the values of the parameters read
+// from registers (see RuntimeExpression::registers). The delayed variables are
+// evaluated by the callback lag(context, pc, time), where pc is the index of
+// the Lag (or LagDerivative) instruction.
+using CompiledFunction = void (*)(double t, const double *x,
+                                  const double *registers, double *outputs,
+                                  double (*lag)(void *, uint32_t, double),
+                                  void *context);
+struct CompiledBytecode;
+
+// The expression, that is defined at runtime (see parse_expressions in
+// parser.hpp), as a symbol, so that it is used as the right hand side of an
+// equation (see RuntimeEquation), or in events, e.g. `When(f == 0.)`. Value is
+// double for the expression with one output, or std::array<double, n> for n
+// outputs. It is evaluated by the interpreter of its bytecode, which is
+// shared by the copies, while the registers are owned by each copy.
+//
+// The bytecode can be compiled to native code (see compile in jit.hpp, which
+// is not included by diffurch.hpp), and then the compiled function is called
+// instead of the interpreter.
+//
+// The derivative D(f) of the runtime expression is not defined, so it can not
+// be located by the root finders, that use it.
+template <typename Value = double> struct RuntimeExpression : Symbol {
+  std::shared_ptr<const Bytecode> bytecode;
+  mutable std::vector<double> registers;
+  // the hints of the delayed variables, see State::eval
+  mutable std::vector<size_t> hints;
+  // the native code of the bytecode, if it was compiled, see compile in
+  // jit.hpp, and its function (null, if it was not compiled)
+  std::shared_ptr<const CompiledBytecode> compiled;
+  CompiledFunction compiled_function = nullptr;
+
+  RuntimeExpression(Bytecode bytecode_)
+      : bytecode(std::make_shared<const Bytecode>(std::move(bytecode_))),
+        registers(bytecode->registers()), hints(bytecode->code.size()) {
+    if (!bytecode->error.empty()) {
+      std::cerr << "diffurch: RuntimeExpression of the bytecode, that was not "
+                   "built: "
+                << bytecode->error << std::endl;
+      std::abort();
+    }
+    if constexpr (std::is_same_v<Value, double>)
+      assert(bytecode->outputs.size() == 1);
+    else
+      assert(bytecode->outputs.size() == std::tuple_size_v<Value>);
+    std::copy(bytecode->constants.begin(), bytecode->constants.end(),
+              registers.begin() + 1 + bytecode->variables);
+  }
+
+  // Sets the value of the parameter, and returns false, if there is no
+  // parameter with this name.
+  bool set_parameter(const std::string &name, double value) {
+    for (const auto &[parameter_name, reg] : bytecode->parameters) {
+      if (parameter_name == name) {
+        registers[reg] = value;
+        return true;
+      }
+    }
+    return false;
+  }
+  double parameter(const std::string &name) const {
+    for (const auto &[parameter_name, reg] : bytecode->parameters)
+      if (parameter_name == name)
+        return registers[reg];
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+
+  auto operator()(const auto &state) const {
+    return run(state, state.t_curr, &state.x_curr);
+  }
+  auto prev(const auto &state) const {
+    return run(state, state.t_prev, &state.x_prev);
+  }
+  auto operator()(const auto &state, double t) const {
+    if (bytecode->reads_state) {
+      auto x = state.template eval<0>(t);
+      return run(state, t, &x);
+    } else {
+      return run(state, t, no_state);
+    }
+  }
+  auto operator()(double t) const {
+    assert(!bytecode->reads_state &&
+           "the expression depends on the state, and not only on time");
+    return run(nullptr, t, no_state);
+  }
+
+  template <size_t coordinate = size_t(-1)> static auto get_events() {
+    return std::make_tuple();
+  }
+
+  // the largest delay with the current parameters
+  double max_delay() const {
+    double result = 0.;
+    for (uint32_t reg : bytecode->delays) {
+      if (reg == Bytecode::no_register)
+        return std::numeric_limits<double>::infinity();
+      result = std::max(result, registers[reg]);
+    }
+    return result;
+  }
+
+private:
+  static constexpr const std::array<double, 0> *no_state = nullptr;
+
+  // the delayed variable, i.e. the coordinate (or its derivative) of the
+  // state at time t, with the coordinate dispatched to State::eval
+  template <typename State>
+  static double lag(const State &state, bool derivative, size_t coordinate,
+                    double t, size_t &hint) {
+    if constexpr (!requires { state.template eval<0, 0>(t, hint); }) {
+      // the past is not available, so there is no correct value to return
+      std::cerr << "diffurch: RuntimeExpression at t = " << t
+                << " reads the delayed variable, and the state does not "
+                   "define eval (the delayed variables require the past of "
+                   "the state)"
+                << std::endl;
+      std::abort();
+    } else {
+      static constexpr size_t n =
+          std::tuple_size_v<std::decay_t<decltype(state.x_curr)>>;
+      return [&]<size_t... i>(std::index_sequence<i...>) {
+        double result = std::numeric_limits<double>::quiet_NaN();
+        ((coordinate == i &&
+          (result = derivative ? state.template eval<1, i>(t, hint)
+                               : state.template eval<0, i>(t, hint),
+           true)) ||
+         ...);
+        return result;
+      }(std::make_index_sequence<n>{});
+    }
+  }
+
+  template <typename State> struct LagContext {
+    const RuntimeExpression *self;
+    const State *state;
+  };
+  // the callback of the compiled function for the delayed variables
+  template <typename State>
+  static double compiled_lag(void *context, uint32_t pc, double t) {
+    auto [self, state] = *static_cast<LagContext<State> *>(context);
+    const Instruction &instruction = self->bytecode->code[pc];
+    return lag(*state, instruction.op == OpCode::LagDerivative,
+               instruction.b, t, self->hints[pc]);
+  }
+
+  template <typename State, typename X>
+  Value run(const State &state, double t, const X *x) const {
+    if (compiled_function) {
+      Value result;
+      LagContext<State> context{this, &state};
+      const double *x_data = nullptr;
+      if constexpr (std::tuple_size_v<X> > 0)
+        x_data = x->data();
+      assert((x_data || !bytecode->reads_state) &&
+             "the expression depends on the state, and not only on time");
+      double *outputs;
+      if constexpr (std::is_same_v<Value, double>)
+        outputs = &result;
+      else
+        outputs = result.data();
+      compiled_function(t, x_data, registers.data(), outputs,
+                        compiled_lag<State>, &context);
+      return result;
+    }
+    double *reg = registers.data();
+    reg[0] = t;
+    if constexpr (std::tuple_size_v<X> > 0) {
+      if (bytecode->reads_state) {
+        assert(x->size() == bytecode->variables);
+        std::copy(x->begin(), x->end(), reg + 1);
+      }
+    }
+    const auto &code = bytecode->code;
+    for (size_t pc = 0; pc < code.size(); pc++) {
+      const Instruction &instruction = code[pc];
+      if (instruction.op == OpCode::Lag ||
+          instruction.op == OpCode::LagDerivative)
+        reg[instruction.result] =
+            lag(state, instruction.op == OpCode::LagDerivative,
+                instruction.b, reg[instruction.a], hints[pc]);
+      else
+        reg[instruction.result] =
+            apply(instruction.op, reg[instruction.a], reg[instruction.b]);
+    }
+    Value result;
+    if constexpr (std::is_same_v<Value, double>) {
+      result = reg[bytecode->outputs[0]];
+    } else {
+      for (size_t i = 0; i < result.size(); i++)
+        result[i] = reg[bytecode->outputs[i]];
+    }
+    return result;
+  }
+};
+
+// the past of the state is evaluated, if the bytecode has delayed variables,
+// which is not known at compile time
+template <typename Value>
+struct has_delayed_variable<RuntimeExpression<Value>> : std::true_type {};
+
+} // namespace diffurch
@@ -0,0 +1,334 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "equation.hpp"
+#include "expression.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace diffurch {
+
+// The bytecode (see bytecode.hpp) is compiled to native code by the system
+// compiler: it is translated to C++ source, in which each instruction is the
+// expression of its operation (see opcode_expression), e.g. `r7 = r5 * r6`,
+// with the same arithmetic as diffurch::apply (so the result is the same as
+// of the interpreter, but there is no switch over the operations), compiled
+// to a shared library, and loaded with dlopen. The libraries are cached on
+// disk by the hash of the source, bytecode.hpp and the compiler command, so
+// the same expressions are compiled once, and loaded at once on the next runs.
+//
+// This header is not included by diffurch.hpp, so that only the programs, that
+// compile the bytecode, are linked with the library of dlopen (see
+// CMakeLists.txt). The compiled function is described in expression.hpp (see
+// CompiledFunction).
+
+struct JitOptions {
+  // where the sources and the libraries are kept
+  std::filesystem::path cache_directory = default_cache_directory();
+  // the compiler, and its flags, with which the source is compiled to a
+  // shared library
+  std::string compiler = default_compiler();
+  std::string flags = "-std=c++20 -O2 -shared -fPIC";
+  // the directory of bytecode.hpp, which is included by the source: the
+  // absolute path DIFFURCH_RUNTIME_DIR given by the build (see
+  // CMakeLists.txt), or the directory of this header as it was compiled (so
+  // the path does not depend on the working directory of the program)
+#ifdef DIFFURCH_RUNTIME_DIR
+  std::filesystem::path include_directory = DIFFURCH_RUNTIME_DIR;
+#else
+  std::filesystem::path include_directory =
+      std::filesystem::path(__FILE__).parent_path();
+#endif
+
+  // $DIFFURCH_JIT_CACHE, or $XDG_CACHE_HOME/diffurch, or ~/.cache/diffurch,
+  // or empty (and the bytecode is not compiled), because the shared temporary
+  // directory is writable by the other users
+  static std::filesystem::path default_cache_directory() {
+    if (const char *path = std::getenv("DIFFURCH_JIT_CACHE"); path && *path)
+      return path;
+    if (const char *path = std::getenv("XDG_CACHE_HOME"); path && *path)
+      return std::filesystem::path(path) / "diffurch";
+    if (const char *path = std::getenv("HOME"); path && *path)
+      return std::filesystem::path(path) / ".cache" / "diffurch";
+    return {};
+  }
+  // $CXX, or c++
+  static std::string default_compiler() {
+    if (const char *compiler = std::getenv("CXX"); compiler && *compiler)
+      return compiler;
+    return "c++";
+  }
+};
+
+struct CompiledBytecode {
+  // null, if the bytecode was not compiled, see error
+  CompiledFunction function = nullptr;
+  // the handle of the library, which is closed with the last copy
+  std::shared_ptr<void> library;
+  // whether the library was found in the cache, and not compiled
+  bool cached = false;
+  // the description of the error (with the output of the compiler), if the
+  // bytecode was not compiled
+  std::string error;
+};
+
+namespace jit {
+
+// 64-bit FNV-1a, which, unlike std::hash, is the same on every run
+inline uint64_t hash(const std::string &text) {
+  uint64_t result = 14695981039346656037ull;
+  for (unsigned char c : text) {
+    result ^= c;
+    result *= 1099511628211ull;
+  }
+  return result;
+}
+
+// the exact literal of the value
+inline std::string literal(double value) {
+  if (std::isnan(value))
+    return "std::numeric_limits<double>::quiet_NaN()";
+  if (std::isinf(value))
+    return value > 0 ? "std::numeric_limits<double>::infinity()"
+                     : "-std::numeric_limits<double>::infinity()";
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), "%a", value);
+  return buffer;
+}
+
+inline std::string quote(const std::string &argument) {
+  std::string result = "'";
+  for (char c : argument) {
+    if (c == '\'')
+      result += "'\\''";
+    else
+      result += c;
+  }
+  return result + "'";
+}
+
+// Whether the file (or directory) is owned by the user, and is not writable
+// by the others, so that the library loaded from it is not replaced by another
+// user.
+inline bool is_private(const std::filesystem::path &path) {
+  struct stat status;
+  return ::stat(path.c_str(), &status) == 0 && status.st_uid == ::getuid() &&
+         (status.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+inline std::string read_file(const std::filesystem::path &path) {
+  std::ifstream file(path);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+// the C++ source of the function (see CompiledFunction), which evaluates the
+// bytecode
+inline std::string source(const Bytecode &bytecode,
+                          const std::filesystem::path &include_directory) {
+  uint32_t first_constant = 1 + bytecode.variables;
+  uint32_t first_result = first_constant + bytecode.constants.size();
+  std::vector<bool> is_parameter(bytecode.constants.size());
+  for (const auto &[name, reg] : bytecode.parameters)
+    is_parameter[reg - first_constant] = true;
+  auto operand = [&](uint32_t reg) -> std::string {
+    if (reg == 0)
+      return "t";
+    if (reg < first_constant)
+      return "x[" + std::to_string(reg - 1) + "]";
+    if (reg < first_result) {
+      if (is_parameter[reg - first_constant])
+        return "registers[" + std::to_string(reg) + "]";
+      return literal(bytecode.constants[reg - first_constant]);
+    }
+    return "r" + std::to_string(reg);
+  };
+
+  std::ostringstream out;
+  out << "#include \"" << (include_directory / "bytecode.hpp").string()
+      << "\"\n"
+         "#include <cmath>\n"
+         "#include <cstdint>\n"
+         "#include <limits>\n\n"
+         "extern \"C\" void diffurch_compiled_bytecode(\n"
+         "    double t, const double *x, const double *registers,\n"
+         "    double *outputs, double (*lag)(void *, uint32_t, double),\n"
+         "    void *context) {\n";
+  for (size_t pc = 0; pc < bytecode.code.size(); pc++) {
+    const Instruction &instruction = bytecode.code[pc];
+    out << "  const double " << operand(instruction.result) << " = ";
+    if (instruction.op == OpCode::Lag ||
+        instruction.op == OpCode::LagDerivative)
+      out << "lag(context, " << pc << ", " << operand(instruction.a) << ")";
+    else
+      out << opcode_expression(instruction.op, operand(instruction.a),
+                               is_binary(instruction.op)
+                                   ? operand(instruction.b)
+                                   : std::string("0."));
+    out << ";\n";
+  }
+  for (size_t i = 0; i < bytecode.outputs.size(); i++)
+    out << "  outputs[" << i << "] = " << operand(bytecode.outputs[i])
+        << ";\n";
+  out << "  (void)t, (void)x, (void)registers, (void)lag, (void)context;\n"
+         "}\n";
+  return out.str();
+}
+
+} // namespace jit
+
+// The compiled bytecode, which is loaded from the cache, or compiled and
+// saved to the cache. If the compiler is not found, or fails, the function is
+// null, and error is its output.
+inline CompiledBytecode compile_bytecode(const Bytecode &bytecode,
+                                         const JitOptions &options = {}) {
+  CompiledBytecode compiled;
+  if (!bytecode.error.empty()) {
+    compiled.error = "the bytecode was not built: " + bytecode.error;
+    return compiled;
+  }
+  std::string source = jit::source(bytecode, options.include_directory);
+  std::string command = options.compiler + " " + options.flags;
+  // bytecode.hpp is hashed too, so that the libraries of the older versions
+  // of diffurch::apply are not loaded
+  std::string header =
+      jit::read_file(options.include_directory / "bytecode.hpp");
+  char name[32];
+  std::snprintf(
+      name, sizeof(name), "%016llx",
+      (unsigned long long)jit::hash(command + "\n" + header + "\n" + source));
+  const auto &directory = options.cache_directory;
+  auto library_path = directory / (std::string(name) + ".so");
+
+  auto load = [&] {
+    if (!jit::is_private(library_path)) {
+      compiled.error = library_path.string() +
+                       " is not owned by the user, or is writable by others";
+      return;
+    }
+    void *handle = dlopen(library_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+      compiled.error = dlerror();
+      return;
+    }
+    compiled.library = std::shared_ptr<void>(handle, dlclose);
+    compiled.function = reinterpret_cast<CompiledFunction>(
+        dlsym(handle, "diffurch_compiled_bytecode"));
+    if (!compiled.function)
+      compiled.error = dlerror();
+  };
+
+  // the cache directory is created accessible by the user only, and the
+  // existing one is used, only if the others can not write to it
+  if (directory.empty()) {
+    compiled.error = "the cache directory is not set";
+    return compiled;
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(directory.parent_path(), ec);
+  if (::mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+    compiled.error = "can not create " + directory.string() + ": " +
+                     std::strerror(errno);
+    return compiled;
+  }
+  if (!jit::is_private(directory)) {
+    compiled.error = directory.string() +
+                     " is not owned by the user, or is writable by others";
+    return compiled;
+  }
+
+  if (std::filesystem::exists(library_path, ec)) {
+    compiled.cached = true;
+    load();
+    if (compiled.function)
+      return compiled;
+    // the library is not loaded, so it is compiled again
+    compiled = CompiledBytecode{};
+  }
+
+  // the source and the library are written to the unique temporary files,
+  // and renamed, so that the processes, which compile the same source at the
+  // same time, do not compile the incomplete source, or load the incomplete
+  // library
+  static std::atomic<unsigned> counter = 0;
+  std::string unique = std::string(name) + "." + std::to_string(getpid()) +
+                       "." + std::to_string(counter++);
+  auto source_path = directory / (std::string(name) + ".cpp");
+  auto temporary_source_path = directory / (unique + ".cpp");
+  auto temporary_path = directory / (unique + ".so.tmp");
+  auto log_path = directory / (unique + ".log");
+  std::ofstream source_file(temporary_source_path);
+  source_file << source;
+  source_file.close();
+  if (!source_file) {
+    compiled.error = "can not write " + temporary_source_path.string();
+    std::filesystem::remove(temporary_source_path, ec);
+    return compiled;
+  }
+  std::string compile_command =
+      command + " -o " + jit::quote(temporary_path.string()) + " " +
+      jit::quote(temporary_source_path.string()) + " > " +
+      jit::quote(log_path.string()) + " 2>&1";
+  int status = std::system(compile_command.c_str());
+  std::string log = jit::read_file(log_path);
+  std::filesystem::remove(log_path, ec);
+  // the source is kept next to the library
+  std::filesystem::rename(temporary_source_path, source_path, ec);
+  if (ec)
+    std::filesystem::remove(temporary_source_path, ec);
+  if (status != 0) {
+    compiled.error = "`" + compile_command + "` failed:\n" + log;
+    std::filesystem::remove(temporary_path, ec);
+    return compiled;
+  }
+  // the library is not writable by the others, whatever the umask is
+  std::filesystem::permissions(temporary_path,
+                               std::filesystem::perms::owner_all, ec);
+  std::filesystem::rename(temporary_path, library_path, ec);
+  if (ec) {
+    compiled.error = "can not write " + library_path.string() + ": " +
+                     ec.message();
+    std::filesystem::remove(temporary_path, ec);
+    return compiled;
+  }
+  load();
+  return compiled;
+}
+
+// Compiles the bytecode of the expression to native code (or loads it from the
+// cache, see compile_bytecode), and returns false, if it is not compiled, in
+// which case the interpreter is used, and expression.compiled->error is the
+// description of the error.
+template <typename Value>
+bool compile(RuntimeExpression<Value> &expression,
+             const JitOptions &options = {}) {
+  expression.compiled = std::make_shared<const CompiledBytecode>(
+      compile_bytecode(*expression.bytecode, options));
+  expression.compiled_function = expression.compiled->function;
+  return expression.compiled_function != nullptr;
+}
+
+// Compiles the right hand side of the equation to native code, and returns
+// false, if it is not compiled, in which case it is interpreted (see
+// equation.rhs.compiled->error). The initial condition is always interpreted.
+template <size_t n>
+bool compile(RuntimeEquation<n> &equation, const JitOptions &options = {}) {
+  return equation.error.empty() && compile(equation.rhs, options);
+}
+
+} // namespace diffurch
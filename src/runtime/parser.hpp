@@ -0,0 +1,224 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <numbers>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace diffurch {
+
+// Parser of the expressions like "-x + 0.5 * x(t - tau) / (1 + x(t - tau)^10)"
+// to the bytecode (see bytecode.hpp), with the grammar
+//   sum     = product {("+" | "-") product}
+//   product = unary {("*" | "/") unary}
+//   unary   = "-" unary | power
+//   power   = primary ["^" unary]
+//   primary = number | "(" sum ")" | "t" | "pi" | parameter | variable
+//           | variable "(" sum ")" | variable "'" "(" sum ")"
+//           | function "(" sum ["," sum] ")"
+// where `x(arg)` is the delayed variable, and `x'(arg)` is its derivative (for
+// neutral equations). The functions are sin, cos, tan, exp, log, sqrt, abs,
+// sign, of one argument, and pow, atan2 of two arguments. Unlike dsign of the
+// symbolic expressions, sign is evaluated as is at each stage, and its
+// switches are not located by events, so the steps over the switches are
+// made with the lower order of accuracy.
+class ExpressionParser {
+  BytecodeBuilder &builder;
+  const std::vector<std::string> &variables;
+  const std::map<std::string, double> &parameters;
+  const std::string &text;
+  size_t position = 0;
+
+public:
+  std::string error;
+
+  ExpressionParser(BytecodeBuilder &builder_,
+                   const std::vector<std::string> &variables_,
+                   const std::map<std::string, double> &parameters_,
+                   const std::string &text_)
+      : builder(builder_), variables(variables_), parameters(parameters_),
+        text(text_) {}
+
+  // the register of the value of the whole text, or of garbage, if error is
+  // not empty
+  uint32_t parse() {
+    uint32_t result = sum();
+    skip_spaces();
+    if (position < text.size())
+      fail("unexpected '" + std::string(1, text[position]) + "'");
+    return result;
+  }
+
+private:
+  void fail(const std::string &message) {
+    if (error.empty())
+      error = message + " at position " + std::to_string(position) +
+              " of \"" + text + "\"";
+  }
+  void skip_spaces() {
+    while (position < text.size() &&
+           std::isspace(static_cast<unsigned char>(text[position])))
+      position++;
+  }
+  bool accept(char c) {
+    skip_spaces();
+    if (position < text.size() && text[position] == c) {
+      position++;
+      return true;
+    }
+    return false;
+  }
+  void expect(char c) {
+    if (!accept(c))
+      fail(std::string("expected '") + c + "'");
+  }
+
+  uint32_t sum() {
+    uint32_t result = product();
+    while (error.empty()) {
+      if (accept('+'))
+        result = builder.apply(OpCode::Add, result, product());
+      else if (accept('-'))
+        result = builder.apply(OpCode::Sub, result, product());
+      else
+        break;
+    }
+    return result;
+  }
+  uint32_t product() {
+    uint32_t result = unary();
+    while (error.empty()) {
+      if (accept('*'))
+        result = builder.apply(OpCode::Mul, result, unary());
+      else if (accept('/'))
+        result = builder.apply(OpCode::Div, result, unary());
+      else
+        break;
+    }
+    return result;
+  }
+  uint32_t unary() {
+    if (accept('-'))
+      return builder.apply(OpCode::Neg, unary());
+    return power();
+  }
+  uint32_t power() {
+    uint32_t base = primary();
+    if (error.empty() && accept('^'))
+      return builder.apply(OpCode::Pow, base, unary());
+    return base;
+  }
+
+  uint32_t primary() {
+    skip_spaces();
+    if (position == text.size()) {
+      fail("unexpected end");
+      return 0;
+    }
+    if (accept('(')) {
+      uint32_t result = sum();
+      expect(')');
+      return result;
+    }
+    char c = text[position];
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      const char *begin = text.c_str() + position;
+      char *end;
+      double value = std::strtod(begin, &end);
+      if (end == begin) {
+        fail("invalid number");
+        return 0;
+      }
+      position += end - begin;
+      return builder.constant(value);
+    }
+    if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_') {
+      fail("unexpected '" + std::string(1, c) + "'");
+      return 0;
+    }
+    size_t start = position;
+    while (position < text.size() &&
+           (std::isalnum(static_cast<unsigned char>(text[position])) ||
+            text[position] == '_'))
+      position++;
+    std::string name = text.substr(start, position - start);
+
+    for (size_t i = 0; i < variables.size(); i++) {
+      if (variables[i] == name) {
+        bool derivative = accept('\'');
+        if (accept('(')) {
+          uint32_t argument = sum();
+          expect(')');
+          return builder.lag(i, argument, derivative);
+        }
+        if (derivative)
+          fail("expected the argument of " + name + "', e.g. " + name +
+               "'(t - 1)");
+        return builder.variable(i);
+      }
+    }
+    if (name == "t")
+      return builder.time();
+    if (name == "pi")
+      return builder.constant(std::numbers::pi);
+    if (auto it = parameters.find(name); it != parameters.end())
+      return builder.parameter(name, it->second);
+
+    static const std::map<std::string, OpCode> functions = {
+        {"sin", OpCode::Sin},   {"cos", OpCode::Cos},
+        {"tan", OpCode::Tan},   {"exp", OpCode::Exp},
+        {"log", OpCode::Log},   {"sqrt", OpCode::Sqrt},
+        {"abs", OpCode::Abs},
+        {"sign", OpCode::Sign}, // without event location, unlike dsign
+        {"pow", OpCode::Pow},   {"atan2", OpCode::Atan2}};
+    auto it = functions.find(name);
+    if (it == functions.end()) {
+      position = start;
+      fail("unknown name '" + name + "'");
+      return 0;
+    }
+    expect('(');
+    uint32_t a = sum();
+    uint32_t b = 0;
+    bool has_two_arguments =
+        it->second == OpCode::Pow || it->second == OpCode::Atan2;
+    if (has_two_arguments) {
+      expect(',');
+      b = sum();
+    }
+    expect(')');
+    return builder.apply(it->second, a, b);
+  }
+};
+
+// The bytecode of the expressions of the variables (e.g. {"x", "y"} for
+// the state (x, y)), the time t, and the parameters, which can be changed
+// later (see RuntimeExpression::set_parameter), with one output for each
+// expression. If an expression is not parsed, the error of the returned
+// bytecode is its description.
+inline Bytecode
+parse_expressions(const std::vector<std::string> &expressions,
+                  const std::vector<std::string> &variables = {},
+                  const std::map<std::string, double> &parameters = {}) {
+  BytecodeBuilder builder(variables.size());
+  std::string error;
+  for (const auto &expression : expressions) {
+    ExpressionParser parser(builder, variables, parameters, expression);
+    uint32_t result = parser.parse();
+    if (!parser.error.empty() && error.empty())
+      error = parser.error;
+    builder.output(result);
+  }
+  Bytecode bytecode = std::move(builder).build();
+  bytecode.error = error;
+  return bytecode;
+}
+
+} // namespace diffurch
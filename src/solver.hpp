@@ -2,18 +2,71 @@
 
 #include "events.hpp"
 #include "events/handlers.hpp"
+#include "rosenbrock.hpp"
 #include "state.hpp"
 #include "stepsize.hpp"
 #include "symbolic.hpp"
 #include "util/vec.hpp"
+#include <algorithm>
+#include <array>
 #include <boost/preprocessor.hpp>
 #include <cstddef>
 #include <limits>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 #include "rk_tables/rk98.hpp"
 
 namespace diffurch {
+
+// Options, that can be passed as the last arguments of Solver::solution.
+
+// When an event is located within a step, the step is truncated at the event
+// time using dense output, instead of recomputing the step with the shorter
+// stepsize. The K values of the whole step are kept for interpolation.
+struct InterpolateAtEvents {};
+
+// The work done by the solver is counted (see Statistics in statistics.hpp),
+// and the Statistics are returned as the last element of the solution tuple.
+// Without this option, the counting is compiled out.
+struct CollectStatistics {};
+
+// Identical subexpressions of the right hand side are evaluated each time they
+// occur, instead of once per evaluation (see common_subexpressions.hpp).
+struct RepeatSubexpressions {};
+
+// Whether the Runge-Kutta method has the First Same As Last property, which
+// is declared by `constexpr static bool fsal = true;` in its table: the last
+// stage is evaluated at the end of the step with the weights b, so that it is
+// the first stage of the next step.
+template <typename RK>
+constexpr bool is_fsal_v = requires { requires RK::fsal; };
+
+// Weights of the local error estimate of the embedded method, such that
+// x - x_hat = h * sum_j e[j] * K[j], which are RK::e, if the table declares
+// them, and b - bb otherwise. They are computed at compile time, so the error
+// is estimated with one combination of stages instead of two.
+template <typename RK> constexpr std::array<double, RK::s> error_weights() {
+  if constexpr (requires { RK::e; }) {
+    return RK::e;
+  } else {
+    std::array<double, RK::s> e;
+    for (size_t j = 0; j < RK::s; j++)
+      e[j] = RK::b[j] - RK::bb[j];
+    return e;
+  }
+}
+template <typename RK>
+constexpr std::array<double, RK::s> error_weights_v = error_weights<RK>();
+
+template <typename RK> constexpr bool last_stage_is_step_end() {
+  bool result = RK::c[RK::s - 1] == 1. && RK::b[RK::s - 1] == 0.;
+  for (size_t j = 0; j + 1 < RK::s; j++)
+    result = result && RK::a[RK::s - 1][j] == RK::b[j];
+  return result;
+}
+
 // This class is intended to be exclusively used
 // with Curiously Recurring Template Pattern (CRTP),
 // that is in creating other classes like
@@ -23,81 +76,259 @@ template <typename Equation> struct Solver {
 
   auto get_events() { return std::make_tuple(); }
 
-  template <typename RK = rk98, typename StepsizeControllerT = ConstantStepsize>
+  template <typename RK = rk98, typename History = StepHistory,
+            typename StepsizeControllerT = ConstantStepsize>
   auto
   solution(double initial_time, double final_time,
            StepsizeControllerT stepsize_controller = ConstantStepsize(0.1)) {
 
-    return solution<RK>(initial_time, final_time, stepsize_controller,
-                        std::make_tuple(StepEvent(SaveAll<Equation>())));
+    return solution<RK, History>(
+        initial_time, final_time, stepsize_controller,
+        std::make_tuple(StepEvent(SaveAll<Equation>())));
   }
 
-  template <typename RK = rk98, typename StepsizeControllerT,
-            typename AdditionalEventsT>
+  // History is the layout of the past steps in State (StepHistory or
+  // TransposedStepHistory); it is replaced with NoHistory, if the past steps
+  // are never evaluated
+  template <typename RK = rk98, typename History = StepHistory,
+            typename StepsizeControllerT, typename AdditionalEventsT,
+            typename... Options>
   auto solution(double initial_time, double final_time,
                 StepsizeControllerT stepsize_controller,
-                AdditionalEventsT additional_events) {
+                AdditionalEventsT additional_events,
+                [[maybe_unused]] Options... options) {
+    static constexpr bool interpolate_at_events =
+        (std::is_same_v<Options, InterpolateAtEvents> || ...);
+    static constexpr bool collect_statistics =
+        (std::is_same_v<Options, CollectStatistics> || ...);
+    static constexpr bool share_subexpressions =
+        !(std::is_same_v<Options, RepeatSubexpressions> || ...);
+    using StatisticsPolicy =
+        std::conditional_t<collect_statistics, Statistics, NoStatistics>;
+
     auto self = static_cast<Equation *>(this);
     auto rhs = self->get_rhs();
     auto ic = self->get_ic();
     static constexpr size_t n = std::tuple_size<decltype(ic(0.))>::value;
+    // the search of the shared subexpressions is not instantiated at all with
+    // RepeatSubexpressions
+    auto shared_rhs = [&] {
+      if constexpr (share_subexpressions)
+        return SharedSubexpressions(rhs);
+      else
+        return std::tuple<>();
+    }();
+    auto eval_rhs = [&](const auto &state) {
+      if constexpr (share_subexpressions)
+        return shared_rhs(rhs, state);
+      else
+        return rhs(state);
+    };
 
     auto events = Events(std::tuple_cat(self->get_events(), rhs.get_events(),
                                         additional_events));
     // todo: make Events contructor with arbitrary arguments
 
-    auto state = State<RK, decltype(ic)>(initial_time, ic);
+    // if the past is never evaluated, only the current step is stored
+    static constexpr bool uses_history =
+        has_delayed_variable_v<decltype(rhs)> ||
+        has_delayed_variable_v<decltype(events)>;
+    using StateHistory = std::conditional_t<uses_history, History, NoHistory>;
+
+    auto state = State<RK, decltype(ic), StateHistory, StatisticsPolicy>(
+        initial_time, ic);
     state.t_step = stepsize_controller.initial_stepsize;
+    // past steps that are older than the largest delay are not stored
+    state.max_delay = std::max(rhs.max_delay(), events.max_delay());
 
-    Vec<n> delta_x;
-    Vec<n> delta_x_hat;
+    // the embedded solution is not computed for controllers that do not read
+    // state.error_curr (e.g. ConstantStepsize), so tables without the
+    // embedded method (e.g. rk4) can be used with them
+    static constexpr bool estimates_error = uses_error_v<StepsizeControllerT>;
+    static_assert(!estimates_error || requires { RK::bb; } ||
+                      requires { RK::e; },
+                  "the stepsize controller requires the error estimate, and "
+                  "the table must have an embedded method");
 
-    auto runge_kutta_step = [&]() {
-      for (size_t i = 0; i < RK::s; i++) {
+    // The first stage, rhs at (t_prev, x_prev), does not depend on the
+    // stepsize, so it is not recomputed for the rejected steps, and for the
+    // steps that are redone to the event. For FSAL methods, it is also taken
+    // from the last stage of the previous step, unless events were located or
+    // could change the state or the parameters between the last stage and the
+    // next step (step, call and reject events with set handlers).
+    //
+    // If the last stage evaluates the state in the current step (e.g. for
+    // delays shorter than the step, or state dependent ones), it is computed
+    // with the dense output, that is not complete yet, so it is not reused.
+    //
+    // The transforming handlers (see TransformingHandler) map the stages
+    // K_curr, which are the values of rhs for explicit methods, but not for
+    // Rosenbrock methods, that store them separately.
+    static constexpr bool transforms_stage_rhs =
+        is_rosenbrock_v<RK> &&
+        (decltype(events.step_events)::has_transforming_handlers ||
+         decltype(events.call_events)::has_transforming_handlers ||
+         decltype(events.reject_events)::has_transforming_handlers);
+    static_assert(!is_fsal_v<RK> || last_stage_is_step_end<RK>(),
+                  "the last stage of the FSAL method is not the end of step");
+    static constexpr bool reuse_last_stage =
+        is_fsal_v<RK> && !transforms_stage_rhs &&
+        !decltype(events.step_events)::has_set_handlers &&
+        !decltype(events.call_events)::has_set_handlers &&
+        !decltype(events.reject_events)::has_set_handlers;
+    bool last_stage_evaluated_step = false;
+    static constexpr bool reuse_first_stage_after_reject =
+        !transforms_stage_rhs &&
+        !decltype(events.reject_events)::has_set_handlers;
+    Vec<n> first_stage;
+    bool first_stage_is_known = false;
+
+    // Rosenbrock methods solve linear systems with the Jacobian of rhs in the
+    // stages (see rosenbrock.hpp), and the values of rhs at the stages, which
+    // are the stages K_curr of explicit methods, are stored there
+    auto rosenbrock = [&] {
+      if constexpr (is_rosenbrock_v<RK>)
+        return rosenbrock_stages<RK, n>(rhs);
+      else
+        return nullptr;
+    }();
+    auto &stage_rhs = [&]() -> auto & {
+      if constexpr (is_rosenbrock_v<RK>)
+        return rosenbrock.F;
+      else
+        return state.K_curr;
+    }();
+
+    // the loop over stages is unrolled at compile time, so that the zero
+    // coefficients of the Butcher tableau are skipped (see dot in util/vec.hpp)
+    auto runge_kutta_stage = [&]<size_t i>() {
+      if (i == 0 && first_stage_is_known) {
+        state.t_curr = state.t_prev;
+        state.x_curr = state.x_prev;
+        stage_rhs[0] = first_stage;
+      } else {
         state.t_curr = state.t_prev + state.t_step * RK::c[i];
         state.x_curr =
-            state.x_prev + state.t_step * dot(RK::a[i], state.K_curr, i);
-        state.K_curr[i] = rhs(state);
+            state.x_prev + state.t_step * dot<RK::a[i], i>(state.K_curr);
+        if constexpr (reuse_last_stage && i == RK::s - 1)
+          state.current_step_evaluated = false;
+        stage_rhs[i] = eval_rhs(state);
+        if constexpr (reuse_last_stage && i == RK::s - 1)
+          last_stage_evaluated_step = state.current_step_evaluated;
+        state.count(&Statistics::rhs_calls);
         events.call_events(state);
       }
-      delta_x = state.t_step * dot(RK::b, state.K_curr, RK::s);
-      delta_x_hat = state.t_step * dot(RK::bb, state.K_curr, RK::s);
+      if constexpr (is_rosenbrock_v<RK>)
+        rosenbrock.template stage<i>(state);
+    };
 
+    // returns false, if the step is not made (see RosenbrockStages::factorize)
+    auto runge_kutta_step = [&]() {
+      if constexpr (is_rosenbrock_v<RK>)
+        if (!rosenbrock.factorize(state))
+          return false;
+      [&]<size_t... i>(std::index_sequence<i...>) {
+        (runge_kutta_stage.template operator()<i>(), ...);
+      }(std::make_index_sequence<RK::s>{});
       if constexpr (RK::c[RK::s - 1] != 1.)
         state.t_curr = state.t_prev + state.t_step;
-      state.x_curr = state.x_prev + delta_x;
+      state.x_curr =
+          state.x_prev + state.t_step * dot<RK::b, RK::s>(state.K_curr);
 
-      state.error_curr = delta_x - delta_x_hat;
+      if constexpr (estimates_error)
+        state.error_curr =
+            state.t_step * dot<error_weights_v<RK>, RK::s>(state.K_curr);
+      return true;
     };
 
     events.start_events(state);
     events.step_events(state); // it is here so saving includes 0th step
 
+    // the first stage, that is evaluated for the estimate, is reused in the
+    // first step
+    if constexpr (requires { stepsize_controller.automatic_initial_stepsize; }) {
+      if (stepsize_controller.automatic_initial_stepsize) {
+        double t_init = state.t_curr;
+        Vec<n> x_init = state.x_curr;
+        auto f = [&](double t, const Vec<n> &x) {
+          state.t_curr = t;
+          state.x_curr = x;
+          Vec<n> result = eval_rhs(state);
+          state.count(&Statistics::rhs_calls);
+          events.call_events(state);
+          return result;
+        };
+        first_stage = f(t_init, x_init);
+        first_stage_is_known = true;
+        state.t_step = std::clamp(
+            initial_stepsize_estimate(f, RK::order, t_init, x_init,
+                                      first_stage, stepsize_controller.atol,
+                                      stepsize_controller.rtol),
+            stepsize_controller.min_stepsize, stepsize_controller.max_stepsize);
+        state.t_curr = t_init;
+        state.x_curr = x_init;
+      }
+    }
+
     while (state.t_curr < final_time) {
 
       state.t_prev = state.t_curr;
       state.x_prev = state.x_curr;
+      if constexpr (interpolate_at_events)
+        state.t_dense_step = 0.;
 
-      runge_kutta_step();
+      if (!runge_kutta_step()) {
+        // the step is rejected, as by the stepsize controller below, and
+        // redone with the half stepsize, if the stepsize controller can change
+        // it, down to min_stepsize
+        if constexpr (estimates_error) {
+          if (state.t_step > stepsize_controller.min_stepsize) {
+            state.count(&Statistics::rejected_steps);
+            events.reject_events(state);
+            state.t_curr = state.t_prev;
+            state.x_curr = state.x_prev;
+            state.t_step =
+                std::max(state.t_step / 2, stepsize_controller.min_stepsize);
+            continue;
+          }
+        }
+        singular_rosenbrock_step(state.t_prev, state.t_step);
+      }
 
-      // stepsize for the next step, even if this step is rejected
+      // stepsize for the next step, even if this step is rejected, in which
+      // case the step is redone from t_prev
       bool reject_step = stepsize_controller.template set_stepsize<RK>(state);
-      state.t_step = std::min(state.t_step, final_time - state.t_curr);
+      double t_step_start = reject_step ? state.t_prev : state.t_curr;
+      state.t_step = std::min(state.t_step, final_time - t_step_start);
 
       if (reject_step) {
+        state.count(&Statistics::rejected_steps);
         events.reject_events(state);
         state.t_curr = state.t_prev;
         state.x_curr = state.x_prev;
+        first_stage = stage_rhs[0];
+        first_stage_is_known = reuse_first_stage_after_reject;
         continue;
       }
 
+      state.count(&Statistics::accepted_steps);
       if (double t_event = events.locate(state);
           t_event < std::numeric_limits<double>::max()) {
         double save_t_step = state.t_step;
+        first_stage = stage_rhs[0];
+        first_stage_is_known = true;
 
-        state.t_step = t_event - state.t_prev;
-        runge_kutta_step(); // redo rk step
+        if constexpr (interpolate_at_events) {
+          state.t_dense_step = state.t_curr - state.t_prev;
+          state.x_curr = state.eval(t_event);
+          state.t_curr = t_event;
+        } else {
+          state.t_step = t_event - state.t_prev;
+          if (!runge_kutta_step()) // redo rk step
+            singular_rosenbrock_step(state.t_prev, state.t_step);
+        }
         state.push_back_curr();
+        events.confirm_located(state);
         events.step_events(state);
 
         events.located_event(state);
@@ -111,15 +342,29 @@ template <typename Equation> struct Solver {
         // (it's important to not change the constant time step)
         // (it's important to not sproradicaly reduce adaptive time step)
         state.t_step = save_t_step;
+        // located events may change the state or the rhs
+        first_stage_is_known = false;
+        if constexpr (is_rosenbrock_v<RK>)
+          rosenbrock.discard_jacobian();
       } else {
         state.push_back_curr();
         events.step_events(state);
+        if constexpr (reuse_last_stage) {
+          first_stage = stage_rhs[RK::s - 1];
+          first_stage_is_known = !last_stage_evaluated_step;
+        } else {
+          first_stage_is_known = false;
+        }
       }
     }
 
     events.stop_events(state);
 
-    return events.get_saved();
+    if constexpr (collect_statistics)
+      return std::tuple_cat(events.get_saved(),
+                            std::make_tuple(state.statistics));
+    else
+      return events.get_saved();
   }
 };
 } // namespace diffurch
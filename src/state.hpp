@@ -2,13 +2,34 @@
 #include "util/vec.hpp"
 #include <iostream>
 
+#include "statistics.hpp"
 #include "symbolic.hpp"
+#include "util/ring_buffer.hpp"
 #include <algorithm>
-#include <vector>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
 
 namespace diffurch {
 
-template <typename RK, typename ICType> struct State {
+// Policies, that define which past steps are stored in State.
+struct StepHistory {}; // past steps are stored for evaluation with eval
+struct NoHistory {};   // only the current step is stored
+// past steps are stored, with K values of each coordinate stored contiguously,
+// which is better for evaluation of separate coordinates in large systems
+struct TransposedStepHistory {};
+
+template <typename RK, typename ICType, typename History = StepHistory,
+          typename StatisticsPolicy = NoStatistics>
+struct State {
+
+  static constexpr bool stores_history = !std::is_same_v<History, NoHistory>;
+  static constexpr bool transposed_history =
+      std::is_same_v<History, TransposedStepHistory>;
+  static constexpr bool collects_statistics =
+      std::is_same_v<StatisticsPolicy, Statistics>;
 
   static constexpr size_t n =
       std::tuple_size<decltype(std::declval<ICType>()(0.))>::value;
@@ -18,35 +39,106 @@ template <typename RK, typename ICType> struct State {
   double t_curr;
   double t_prev;
   double t_step;
-  // should be a queue, it used only for interpolation
-  std::vector<decltype(t_curr)> t_sequence;
+  // used only for interpolation, holds the steps that are not older than
+  // max_delay with respect to t_prev
+  RingBuffer<decltype(t_curr)> t_sequence;
+  // The length of the step, on which K_curr were computed, if the step was
+  // truncated at an event using dense output (then it is longer than
+  // t_curr - t_prev), and zero otherwise.
+  double t_dense_step = 0.;
+  // the lengths of the steps, on which the stored K values were computed
+  RingBuffer<double> t_dense_step_sequence;
 
   // dependent variable
   ICType x_init;
   Vec<n> x_curr;
   Vec<n> x_prev;
-  // should be a queue, used only for interpolation
-  std::vector<decltype(x_curr)> x_sequence;
+  RingBuffer<decltype(x_curr)> x_sequence;
 
   // K values for interpolation, runge kutta method must support intrpolation
-  // in the future, queue should be used instead of vector, and the requred time
-  // span of that queue (i.e. the delay time, or )
   std::array<decltype(x_curr), RK::s> K_curr;
-  std::vector<decltype(K_curr)> K_sequence;
+  // with TransposedStepHistory, the elements are K_sequence[i][coordinate][j]
+  RingBuffer<std::conditional_t<transposed_history,
+                                std::array<std::array<double, RK::s>, n>,
+                                decltype(K_curr)>>
+      K_sequence;
 
   Vec<n> error_curr;
 
+  // the largest time span into the past, for which eval can be called;
+  // the steps that are older are discarded from the sequences
+  double max_delay = std::numeric_limits<double>::infinity();
+  // number of steps discarded from the front of the sequences, such that
+  // `popped_steps + i` is an index of the i-th stored step, that does not
+  // change when the older steps are discarded
+  size_t popped_steps = 0;
+
+  // Interpolation weights of the past steps for recently evaluated times.
+  // Delayed variables with the same argument (like `x(t - 1)` and
+  // `D(x)(t - 1)`, or the same delayed variable used twice) are evaluated at
+  // the same time, so the step lookup and the evaluation of polynomials
+  // RK::bs are done once. Since past steps are not changed, the entries stay
+  // valid, until their step is discarded.
+  struct WeightsCacheEntry {
+    double t = std::numeric_limits<double>::quiet_NaN();
+    size_t derivative_order;
+    size_t step_index; // index of the step, i.e. popped_steps + i
+    double scale;      // h for derivative_order = 0, otherwise h^(1 - order)
+    std::array<double, RK::s> weights;
+  };
+  mutable std::array<WeightsCacheEntry, 4> weights_cache;
+  mutable size_t weights_cache_next = 0; // the entry to be overwritten
+
+  // set by eval, when it interpolates in the current step, i.e. between
+  // t_prev and t_curr, with K_curr, that can be incomplete during the stages
+  // (see reuse_last_stage in solver.hpp)
+  mutable bool current_step_evaluated = false;
+
+  // counted also in const methods, such as eval and event location
+  [[no_unique_address]] mutable StatisticsPolicy statistics;
+
+  // Increments the counter of statistics, e.g.
+  // `state.count(&Statistics::rhs_calls)`, if they are collected.
+  void count(size_t Statistics::*counter, size_t increment = 1) const {
+    if constexpr (collects_statistics)
+      statistics.*counter += increment;
+  }
+
   State(double t_init, ICType x_init)
-      : t_init(t_init), t_curr(t_init), t_prev(t_curr), t_sequence({t_curr}),
-        x_init(x_init), x_curr(x_init(t_init)), x_prev(x_curr),
-        x_sequence({x_curr}) {};
+      : t_init(t_init), t_curr(t_init), t_prev(t_curr), x_init(x_init),
+        x_curr(x_init(t_init)), x_prev(x_curr) {
+    if constexpr (stores_history) {
+      t_sequence.push_back(t_curr);
+      x_sequence.push_back(x_curr);
+    }
+  };
 
   void push_back_curr() {
+    if constexpr (!stores_history)
+      return;
+
+    t_dense_step_sequence.push_back(std::max(t_curr - t_prev, t_dense_step));
     t_sequence.push_back(t_curr);
     x_sequence.push_back(x_curr);
-    K_sequence.push_back(K_curr);
+    if constexpr (transposed_history) {
+      typename decltype(K_sequence)::value_type K_transposed;
+      for (size_t j = 0; j < RK::s; j++)
+        for (size_t coordinate = 0; coordinate < n; coordinate++)
+          K_transposed[coordinate][j] = K_curr[j][coordinate];
+      K_sequence.push_back(K_transposed);
+    } else {
+      K_sequence.push_back(K_curr);
+    }
 
-    // pop_front from the queues until t_sequence[1] > t_curr - t_span;
+    // keep the step containing t_prev - max_delay, because past values from
+    // the last step (i.e. in prev methods of symbols) are still evaluated
+    while (t_sequence.size() > 1 && t_sequence[1] <= t_prev - max_delay) {
+      t_sequence.pop_front();
+      t_dense_step_sequence.pop_front();
+      x_sequence.pop_front();
+      K_sequence.pop_front();
+      popped_steps++;
+    }
   }
 
   void make_zero_step() {
@@ -54,51 +146,204 @@ template <typename RK, typename ICType> struct State {
     t_prev = t_curr;
     x_prev = x_curr;
     K_curr = decltype(K_curr){};
+    t_dense_step = 0.;
     push_back_curr();
   }
 
-  template <size_t derivative_order = 0> decltype(x_curr) eval(double t) const {
-    if (t <= t_sequence[0]) { // initial_condition case
+  // Replaces the current and the stored values x with map(x), and the K
+  // values with map(K), for a linear map, so that the dense output of the past
+  // steps is mapped as well. The initial condition is not mapped, so it should
+  // be used only when the past before t_init is no longer evaluated. It is
+  // used for the renormalization of tangent vectors (see lyapunov.hpp).
+  void transform(const auto &map) {
+    x_curr = map(x_curr);
+    x_prev = map(x_prev);
+    for (auto &K : K_curr)
+      K = map(K);
+    if constexpr (stores_history) {
+      for (size_t i = 0; i < x_sequence.size(); i++) {
+        x_sequence[i] = map(x_sequence[i]);
+        if constexpr (transposed_history) {
+          for (size_t j = 0; j < RK::s; j++) {
+            Vec<n> K;
+            for (size_t coordinate = 0; coordinate < n; coordinate++)
+              K[coordinate] = K_sequence[i][coordinate][j];
+            K = map(K);
+            for (size_t coordinate = 0; coordinate < n; coordinate++)
+              K_sequence[i][coordinate][j] = K[coordinate];
+          }
+        } else {
+          for (auto &K : K_sequence[i])
+            K = map(K);
+        }
+      }
+    }
+  }
+
+  // Evaluates the state at time t, or only its coordinate, if the
+  // coordinate is specified (in which case the result is double).
+  template <size_t derivative_order = 0, size_t coordinate = size_t(-1)>
+  auto eval(double t) const {
+    size_t hint = 0;
+    return eval<derivative_order, coordinate>(t, hint);
+  }
+
+  // The same as eval(t), but the search of the step, that contains t, starts
+  // from the step, that was found by the previous call with the same hint.
+  // Since the delayed arguments are evaluated at close and mostly increasing
+  // times, keeping one hint per delayed argument makes the search O(1).
+  template <size_t derivative_order = 0, size_t coordinate = size_t(-1)>
+  auto eval(double t, size_t &hint) const {
+    if (t <= t_init) { // initial_condition case
       // here we separate two cases, because it is rare that we need to define
       // the derivative of the initial condition, in which case
       // initial_condition is defined as a template instead of a regular member
       // function.
+      decltype(x_curr) result;
       if constexpr (derivative_order == 0)
-        return x_init(t);
+        result = x_init(t);
       else if constexpr (IsSymbol<decltype(x_init)>) {
         const auto x_init_derivative = D<derivative_order>(x_init);
-        return x_init_derivative(t);
-      } else { // fallback for non-symbolic initial condition functions
-        return x_init.template eval<derivative_order>(t);
+        result = x_init_derivative(t);
+      } else if constexpr (requires {
+                             x_init.template eval<derivative_order>(t);
+                           }) { // fallback for non-symbolic initial conditions
+        result = x_init.template eval<derivative_order>(t);
+      } else {
+        static_assert(derivative_order == 0,
+                      "the derivative of the initial condition function is "
+                      "not defined: define eval<derivative_order>(t) in it, "
+                      "or wrap it in BackwardDifference (see util/math.hpp)");
       }
+      if constexpr (coordinate == size_t(-1))
+        return result;
+      else
+        return result[coordinate];
     } else if (t >= t_prev && t <= t_curr) {
-      double h = t_curr - t_prev;
+      current_step_evaluated = true;
+      double h = std::max(t_curr - t_prev, t_dense_step);
       double theta = (t - t_prev) / h;
+      return interpolate<derivative_order, coordinate, false>(
+          eval_array<derivative_order>(RK::bs, theta),
+          interpolation_scale<derivative_order>(h), x_prev, K_curr);
+    } else if constexpr (stores_history) {
+      count(&Statistics::history_lookups);
+      const auto &entry = past_weights<derivative_order>(t, hint);
+      size_t i = entry.step_index - popped_steps;
+      return interpolate<derivative_order, coordinate, transposed_history>(
+          entry.weights, entry.scale, x_sequence[i], K_sequence[i]);
+    } else {
+      // the past was not stored, so there is no correct value to return
+      std::cerr << "diffurch: State::eval at t = " << t
+                << " before the current step requires StepHistory (the "
+                   "solver selects NoHistory, when no delayed variables or "
+                   "opaque callables are found at compile time)"
+                << std::endl;
+      std::abort();
+    }
+  }
+
+  // the weights of the past step that contains t, from the cache if possible
+  template <size_t derivative_order>
+  const WeightsCacheEntry &past_weights(double t, size_t &hint) const {
+    for (const auto &entry : weights_cache) {
+      if (entry.t == t && entry.derivative_order == derivative_order &&
+          entry.step_index >= popped_steps)
+        return entry;
+    }
+
+    count(&Statistics::history_searches);
+    size_t i = upper_bound(t, hint);
+    if (i == 0) {
+      // the step, that contains t, was removed from the history
+      std::cerr << "diffurch: State::eval at t = " << t
+                << " before the oldest stored step at t = " << t_sequence[0]
+                << " (the steps older than max_delay are not stored, so the "
+                   "delays should not exceed the max_delay of the equation "
+                   "and the events)"
+                << std::endl;
+      std::abort();
+    }
+    double h = t_dense_step_sequence[i - 1];
+    double theta = (t - t_sequence[i - 1]) / h;
 
-      auto result =
-          dot(eval_array<derivative_order>(RK::bs, theta), K_curr, RK::s);
+    auto &entry = weights_cache[weights_cache_next];
+    weights_cache_next = (weights_cache_next + 1) % weights_cache.size();
+    entry.t = t;
+    entry.derivative_order = derivative_order;
+    entry.step_index = popped_steps + i - 1;
+    entry.scale = interpolation_scale<derivative_order>(h);
+    entry.weights = eval_array<derivative_order>(RK::bs, theta);
+    return entry;
+  }
+
+  template <size_t derivative_order>
+  static double interpolation_scale(double h) {
+    if constexpr (derivative_order == 0)
+      return h;
+    else
+      return std::pow(h, 1. - derivative_order);
+  }
+
+  // Dense output on the step starting at x_left, where weights are
+  // eval_array<derivative_order>(RK::bs, theta), and K[j][coordinate] (or
+  // K[coordinate][j], if transposed) are the K values of the step.
+  template <size_t derivative_order, size_t coordinate, bool transposed>
+  auto interpolate(const std::array<double, RK::s> &weights, double scale,
+                   const decltype(x_curr) &x_left, const auto &K) const {
+    auto component = [&](size_t c) {
+      double result = 0.;
+      for (size_t j = 0; j < RK::s; j++) {
+        if constexpr (transposed)
+          result += weights[j] * K[c][j];
+        else
+          result += weights[j] * K[j][c];
+      }
       if constexpr (derivative_order == 0)
-        result = x_prev + h * result;
+        return x_left[c] + scale * result;
       else
-        result = pow(h, 1 - derivative_order) * result;
+        return scale * result;
+    };
+
+    if constexpr (coordinate == size_t(-1)) {
+      decltype(x_curr) result;
+      for (size_t c = 0; c < n; c++)
+        result[c] = component(c);
       return result;
     } else {
-      // t_sequence[i] would be the first element > t
-      // std::cout << i << "/" << t_sequence.size() << std::endl;
-      int i = std::distance(
-          t_sequence.begin(),
-          std::upper_bound(t_sequence.begin(), t_sequence.end(), t));
-      double h = t_sequence[i] - t_sequence[i - 1];
-      double theta = (t - t_sequence[i - 1]) / h;
-
-      auto result = dot(eval_array<derivative_order>(RK::bs, theta),
-                        K_sequence[i - 1], RK::s);
-      if constexpr (derivative_order == 0)
-        result = x_sequence[i - 1] + h * result;
+      return component(coordinate);
+    }
+  }
+
+  // upper_bound that looks a few steps around the hint first
+  size_t upper_bound(double t, size_t &hint) const {
+    size_t i = hint > popped_steps ? hint - popped_steps : 0;
+    for (size_t k = 0; k < 4 && 0 < i && i < t_sequence.size(); k++) {
+      if (t_sequence[i - 1] > t)
+        i--;
+      else if (t_sequence[i] <= t)
+        i++;
+      else {
+        hint = popped_steps + i;
+        return i;
+      }
+    }
+    i = upper_bound(t);
+    hint = popped_steps + i;
+    return i;
+  }
+
+  // index of the first element of t_sequence that is greater than t
+  size_t upper_bound(double t) const {
+    size_t l = 0, r = t_sequence.size();
+    while (l < r) {
+      size_t m = (l + r) / 2;
+      if (t_sequence[m] <= t)
+        l = m + 1;
       else
-        result = pow(h, 1 - derivative_order) * result;
-      return result;
+        r = m;
     }
+    return l;
   }
 };
 
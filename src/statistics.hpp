@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+namespace diffurch {
+
+// Counters of the work done by Solver::solution, that are collected in State,
+// if the option CollectStatistics is passed.
+struct Statistics {
+  size_t rhs_calls = 0;      // evaluations of the right hand side
+  size_t accepted_steps = 0; // including the steps truncated at events
+  size_t rejected_steps = 0;
+  // calls of locate of the events with detection, one per event per step
+  size_t locate_calls = 0;
+  // evaluations of event functions (and of their derivatives for Newton)
+  // during root finding, that is about one per iteration of the root finder
+  size_t root_finder_evaluations = 0;
+  // evaluations of the state in the past steps (i.e. of delayed variables)
+  size_t history_lookups = 0;
+  // the lookups, for which the step was searched, because the interpolation
+  // weights were not cached
+  size_t history_searches = 0;
+  // evaluations of the Jacobian, and LU decompositions of the matrices of
+  // the linear systems, by Rosenbrock methods (see rosenbrock.hpp)
+  size_t jacobian_evaluations = 0;
+  size_t lu_decompositions = 0;
+
+  bool operator==(const Statistics &) const = default;
+};
+// Policy for State, for which no statistics are collected, and counting is
+// compiled out.
+struct NoStatistics {};
+
+} // namespace diffurch
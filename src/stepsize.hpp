@@ -1,10 +1,18 @@
 #pragma once
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
 #include <math.h>
 
 namespace diffurch {
 
 struct ConstantStepsize {
+  // the error of the step is not read, so the solver does not estimate it
+  static constexpr bool uses_error = false;
 
   double initial_stepsize;
 
@@ -16,6 +24,28 @@ struct ConstantStepsize {
   }
 };
 
+// Whether the stepsize controller reads state.error_curr in set_stepsize. The
+// controllers may declare `static constexpr bool uses_error = false`; otherwise
+// the error is estimated in each step, which requires a table with an
+// embedded method.
+template <typename StepsizeControllerT>
+constexpr bool uses_error_v = [] {
+  if constexpr (requires { StepsizeControllerT::uses_error; })
+    return StepsizeControllerT::uses_error;
+  else
+    return true;
+}();
+
+// The error for the step of the minimal size, whose error is not finite (the
+// step overflowed), so that it can be neither accepted nor redone with a
+// smaller stepsize.
+[[noreturn]] inline void nonfinite_error_step(double t, double h) {
+  std::cerr << "diffurch: the error of the step at t = " << t
+            << " of the minimal size h = " << h << " is not finite"
+            << std::endl;
+  std::abort();
+}
+
 struct AdaptiveStepsize {
   double atol = 1.e-7;
   double rtol = 1.e-7;
@@ -25,15 +55,24 @@ struct AdaptiveStepsize {
 
   double max_stepsize = 10;
   double min_stepsize = 1.e-7;
+  // initial_stepsize is ignored, and the initial stepsize is estimated by the
+  // solver with initial_stepsize_estimate
+  bool automatic_initial_stepsize = false;
 
   template <typename RK, typename StateT> bool set_stepsize(StateT &state) {
     static constexpr size_t n = StateT::n;
 
     double error = 0;
     for (size_t i = 0; i < n; i++) {
-      error = std::max(error, std::abs(state.error_curr[i]) /
-                                  (atol + std::abs(state.x_curr[i]) * rtol));
+      double scaled = std::abs(state.error_curr[i]) /
+                      (atol + std::abs(state.x_curr[i]) * rtol);
+      // the step, that overflowed, is rejected
+      if (std::isnan(scaled))
+        error = std::numeric_limits<double>::infinity();
+      error = std::max(error, scaled);
     }
+    if (!std::isfinite(error) && state.t_step <= min_stepsize)
+      nonfinite_error_step(state.t_prev, state.t_step);
 
     double fac;
     static constexpr size_t q = std::min(RK::order_embedded, RK::order);
@@ -41,11 +80,203 @@ struct AdaptiveStepsize {
     fac = std::min(fac, max_factor);
     fac = std::max(fac, 1. / max_factor);
 
+    // the step of the minimal size is accepted, as in PIStepsize, so that the
+    // integration does not stall, when the tolerance is not achievable (but
+    // the step, that overflowed, is not, see nonfinite_error_step)
+    bool reject = error > 1 && state.t_step > min_stepsize;
     state.t_step =
         std::min(max_stepsize, std::max(min_stepsize, state.t_step * fac));
-    return error > 1;
+    return reject;
+  };
+};
+
+// Estimate of the initial stepsize by Hairer and Wanner (Solving Ordinary
+// Differential Equations I, II.4), for the method of the given order, where
+// f(t, x) is the right hand side, and f0 = f(t0, x0). The stepsize h0 is
+// chosen such that the explicit Euler step is small compared to x0, then the
+// second derivative is estimated with one more evaluation f(t0 + h0, x1), and
+// the stepsize is chosen such that the local error h^(order + 1) * max(|f0|,
+// |f'|) is about 0.01 in the norm scaled by the tolerance.
+template <size_t n, typename F>
+double initial_stepsize_estimate(const F &f, size_t order, double t0,
+                                 const std::array<double, n> &x0,
+                                 const std::array<double, n> &f0, double atol,
+                                 double rtol) {
+  auto scaled_norm = [&](const auto &value) {
+    double result = 0;
+    for (size_t i = 0; i < n; i++) {
+      double scaled = value[i] / (atol + rtol * std::abs(x0[i]));
+      result += scaled * scaled;
+    }
+    return std::sqrt(result / n);
+  };
+
+  double d0 = scaled_norm(x0);
+  double d1 = scaled_norm(f0);
+  double h0 = (d0 < 1.e-5 || d1 < 1.e-5) ? 1.e-6 : 0.01 * d0 / d1;
+
+  std::array<double, n> x1;
+  for (size_t i = 0; i < n; i++)
+    x1[i] = x0[i] + h0 * f0[i];
+  std::array<double, n> f1 = f(t0 + h0, x1);
+  std::array<double, n> df;
+  for (size_t i = 0; i < n; i++)
+    df[i] = f1[i] - f0[i];
+  double d2 = scaled_norm(df) / h0;
+
+  double h1 = std::max(d1, d2) <= 1.e-15
+                  ? std::max(1.e-6, h0 * 1.e-3)
+                  : std::pow(0.01 / std::max(d1, d2), 1. / (order + 1.));
+  return std::min(100 * h0, h1);
+}
+
+// The norm of the local error state.error_curr, scaled by the tolerance
+// atol + rtol * max(|x_prev|, |x_curr|) in each coordinate, so that the step
+// is accepted, if it is not greater than 1. It is the root mean square of the
+// scaled coordinates (as in the codes of Hairer), if rms_norm is true, and
+// their maximum otherwise.
+template <typename StateT>
+double scaled_error_norm(const StateT &state, double atol, double rtol,
+                         bool rms_norm) {
+  static constexpr size_t n = StateT::n;
+  double error = 0;
+  for (size_t i = 0; i < n; i++) {
+    double scale = atol + rtol * std::max(std::abs(state.x_prev[i]),
+                                          std::abs(state.x_curr[i]));
+    double scaled = std::abs(state.error_curr[i]) / scale;
+    // the step, that overflowed, is rejected
+    if (std::isnan(scaled))
+      return std::numeric_limits<double>::infinity();
+    if (rms_norm)
+      error += scaled * scaled;
+    else
+      error = std::max(error, scaled);
+  }
+  return rms_norm ? std::sqrt(error / n) : error;
+}
+
+// Proportional-integral controller of Gustafsson: the stepsize is multiplied
+// by safety * err^(-alpha / k) * err_prev^(beta / k), where err and err_prev
+// are the scaled errors of the current and the previous accepted steps, and
+// k = q + 1 for the order q of the error estimate. The error of the previous
+// step damps the oscillations of the stepsize, that cause the repeated
+// rejections of the I controller (AdaptiveStepsize). After a rejected step,
+// the stepsize is reduced by the current error only, and it is not increased
+// in the next accepted step.
+struct PIStepsize {
+  double atol = 1.e-7;
+  double rtol = 1.e-7;
+  double initial_stepsize = 0.05;
+  double alpha = 0.7;
+  double beta = 0.4;
+  double safety = 0.9;
+  double max_factor = 5;
+  double min_factor = 0.2;
+  bool rms_norm = true;
+
+  double max_stepsize = 10;
+  double min_stepsize = 1.e-7;
+  bool automatic_initial_stepsize = false; // see AdaptiveStepsize
+
+  // the scaled error of the last accepted step (bounded from below, so that
+  // very small errors do not reduce the next stepsize), and whether the last
+  // step was rejected
+  double error_prev = 1.;
+  bool rejected_prev = false;
+
+  template <typename RK, typename StateT> bool set_stepsize(StateT &state) {
+    static constexpr double k = std::min(RK::order_embedded, RK::order) + 1.;
+    double error = std::max(
+        scaled_error_norm(state, atol, rtol, rms_norm), 1.e-10);
+    if (!std::isfinite(error) && state.t_step <= min_stepsize)
+      nonfinite_error_step(state.t_prev, state.t_step);
+
+    bool reject = error > 1 && state.t_step > min_stepsize;
+    double fac;
+    if (reject) {
+      fac = std::min(1., safety * std::pow(error, -1. / k));
+    } else {
+      fac = safety * std::pow(error, -alpha / k) *
+            std::pow(error_prev, beta / k);
+      if (rejected_prev)
+        fac = std::min(fac, 1.);
+      error_prev = std::max(error, 1.e-4);
+    }
+    rejected_prev = reject;
+    fac = std::clamp(fac, min_factor, max_factor);
+
+    state.t_step =
+        std::clamp(state.t_step * fac, min_stepsize, max_stepsize);
+    return reject;
   };
 };
 
-/*auto a = AdaptiveStepsize{.atol = 1, .rtol = 3};*/
+// Digital filter controller of Söderlind, which uses the errors of the last
+// three steps and the ratios of the last stepsizes:
+//   h_next = h * (1 / err)^(beta1 / k) * (1 / err_prev)^(beta2 / k) *
+//            (1 / err_prev_prev)^(beta3 / k) * (h / h_prev)^(-alpha2) *
+//            (h_prev / h_prev_prev)^(-alpha3),
+// with k = q + 1 for the order q of the error estimate. The default
+// coefficients are of the PID controller H312PID; other filters of Söderlind
+// (Digital filters in adaptive time-stepping, 2003) are, for example,
+// H211PI {1/6, 1/6, 0, 0, 0}, H211b {1/4, 1/4, 0, 1/4, 0}, and
+// PI42 {3/5, -1/5, 0, 0, 0}. The rejected steps are handled as in PIStepsize.
+struct PIDStepsize {
+  double atol = 1.e-7;
+  double rtol = 1.e-7;
+  double initial_stepsize = 0.05;
+  double beta1 = 1. / 18.;
+  double beta2 = 1. / 9.;
+  double beta3 = 1. / 18.;
+  double alpha2 = 0.;
+  double alpha3 = 0.;
+  double safety = 0.9;
+  double max_factor = 5;
+  double min_factor = 0.2;
+  bool rms_norm = true;
+
+  double max_stepsize = 10;
+  double min_stepsize = 1.e-7;
+  bool automatic_initial_stepsize = false; // see AdaptiveStepsize
+
+  // the scaled errors and the stepsize ratios of the last accepted steps, and
+  // whether the last step was rejected
+  double error_prev = 1.;
+  double error_prev_prev = 1.;
+  double ratio_prev = 1.;  // h / h_prev for the last accepted step
+  double t_step_prev = 0.; // the last accepted stepsize
+  bool rejected_prev = false;
+
+  template <typename RK, typename StateT> bool set_stepsize(StateT &state) {
+    static constexpr double k = std::min(RK::order_embedded, RK::order) + 1.;
+    double error = std::max(
+        scaled_error_norm(state, atol, rtol, rms_norm), 1.e-10);
+    if (!std::isfinite(error) && state.t_step <= min_stepsize)
+      nonfinite_error_step(state.t_prev, state.t_step);
+
+    bool reject = error > 1 && state.t_step > min_stepsize;
+    double fac;
+    if (reject) {
+      fac = std::min(1., safety * std::pow(error, -1. / k));
+    } else {
+      double ratio = t_step_prev > 0 ? state.t_step / t_step_prev : 1.;
+      fac = safety * std::pow(error, -beta1 / k) *
+            std::pow(error_prev, -beta2 / k) *
+            std::pow(error_prev_prev, -beta3 / k) * std::pow(ratio, -alpha2) *
+            std::pow(ratio_prev, -alpha3);
+      if (rejected_prev)
+        fac = std::min(fac, 1.);
+      error_prev_prev = error_prev;
+      error_prev = std::max(error, 1.e-4);
+      ratio_prev = ratio;
+      t_step_prev = state.t_step;
+    }
+    rejected_prev = reject;
+    fac = std::clamp(fac, min_factor, max_factor);
+
+    state.t_step =
+        std::clamp(state.t_step * fac, min_stepsize, max_stepsize);
+    return reject;
+  };
+};
 } // namespace diffurch
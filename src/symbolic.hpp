@@ -1,7 +1,9 @@
 #pragma once
 
+#include "symbolic/common_subexpressions.hpp"
 #include "symbolic/detect_symbols.hpp"
 #include "symbolic/discontinuous.hpp"
+#include "symbolic/jacobian.hpp"
 #include "symbolic/math.hpp"
 #include "symbolic/operators.hpp"
 #include "symbolic/set_symbols.hpp"
@@ -0,0 +1,312 @@
+#pragma once
+
+#include "../util/type_traits.hpp"
+#include "operators.hpp"
+#include "symbol_types.hpp"
+#include "variables.hpp"
+#include "vector.hpp"
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace diffurch {
+
+// Common subexpression elimination. Identical subexpressions, such as
+// `D(x)(t - 1)` in `D(x)(t - 1) + pow(D(x)(t - 1), 3)`, or the factors
+// repeated by the product rule in derivatives and Jacobians, are evaluated
+// once per evaluation of the expression.
+//
+// The subexpressions are found at compile time: they are identical, if they
+// have the same type and the same constants, which are compared once, when
+// SharedSubexpressions is constructed. Only the nodes, that are evaluated
+// from their children (the ones that define `children()`, i.e. arithmetic
+// operators, functions of math.hpp, Vector, and Matrix), and the delayed
+// variables are shared. The other nodes (e.g. dsign, which holds the value
+// set by its events) are evaluated as they are, and their arguments are not
+// searched.
+
+// The nodes, that are evaluated from their children only. The member
+// `children()` returns the tuple of (references to) the children, in the order
+// of the arguments of the constructor of the node.
+template <typename T>
+concept HasSubexpressions = requires(const T &node) { node.children(); };
+
+// The cost of evaluation of the expression, in the number of additions and
+// multiplications. The functions, divisions, and delayed variables are
+// counted as several operations.
+template <typename T> constexpr size_t evaluation_cost_v = 0;
+template <HasSubexpressions T>
+constexpr size_t evaluation_cost_v<T> = [] {
+  using Children =
+      std::remove_cvref_t<decltype(std::declval<const T &>().children())>;
+  size_t cost = is_kind_of_v<T, Add> || is_kind_of_v<T, Sub> ||
+                        is_kind_of_v<T, Mul> || is_kind_of_v<T, Neg> ||
+                        is_kind_of_v<T, Vector>
+                    ? 1
+                    : 8;
+  [&]<size_t... i>(std::index_sequence<i...>) {
+    ((cost += evaluation_cost_v<
+          std::remove_cvref_t<std::tuple_element_t<i, Children>>>),
+     ...);
+  }(std::make_index_sequence<std::tuple_size_v<Children>>{});
+  return cost;
+}();
+template <size_t coordinate, typename Arg, size_t derivative_order>
+constexpr size_t
+    evaluation_cost_v<VariableAt<coordinate, Arg, derivative_order>> =
+        8 + evaluation_cost_v<Arg>;
+
+// The subexpressions, that are shared, if they occur several times. A few
+// arithmetic operations are cheaper than the store and the load of the shared
+// value, so they are shared only as parts of larger subexpressions.
+template <typename T>
+constexpr bool is_shareable_v =
+    IsSymbol<T> && HasSubexpressions<T> && evaluation_cost_v<T> >= 3;
+template <size_t coordinate, typename Arg, size_t derivative_order>
+constexpr bool
+    is_shareable_v<VariableAt<coordinate, Arg, derivative_order>> = true;
+
+// The node of the expression at the path of child indices.
+template <typename T>
+const auto &node_at(const T &node, std::index_sequence<>) {
+  return node;
+}
+template <typename T, size_t i, size_t... path>
+const auto &node_at(const T &node, std::index_sequence<i, path...>) {
+  return node_at(std::get<i>(node.children()), std::index_sequence<path...>{});
+}
+
+// Whether the expressions of the same type have the same value for any state.
+// The nodes, that hold something besides constants and children, are assumed
+// to be different.
+template <typename T> bool same_value(const T &a, const T &b) {
+  if constexpr (std::is_empty_v<T>) {
+    return true;
+  } else if constexpr (HasSubexpressions<T>) {
+    return [&]<size_t... i>(std::index_sequence<i...>) {
+      return (same_value(std::get<i>(a.children()),
+                         std::get<i>(b.children())) &&
+              ...);
+    }(std::make_index_sequence<std::tuple_size_v<
+          std::remove_cvref_t<decltype(a.children())>>>{});
+  } else {
+    return false;
+  }
+}
+template <typename T>
+bool same_value(const Constant<T> &a, const Constant<T> &b) {
+  if constexpr (requires { bool(a.value == b.value); })
+    return a.value == b.value;
+  else
+    return false;
+}
+template <size_t coordinate, typename Arg, size_t derivative_order>
+bool same_value(const VariableAt<coordinate, Arg, derivative_order> &a,
+                const VariableAt<coordinate, Arg, derivative_order> &b) {
+  return same_value(a.arg, b.arg);
+}
+
+// The shareable subexpressions of the expression T at Path, in postorder
+// (the subexpressions of a node are before it), as Occurrence types.
+template <typename T, typename Path> struct Occurrence {
+  using type = T;
+  using path = Path;
+};
+
+template <typename T, typename Path> struct subexpression_occurrences {
+  using type =
+      std::conditional_t<is_shareable_v<T>, std::tuple<Occurrence<T, Path>>,
+                         std::tuple<>>;
+};
+template <HasSubexpressions T, size_t... path>
+struct subexpression_occurrences<T, std::index_sequence<path...>> {
+  using Children = std::remove_cvref_t<decltype(std::declval<const T &>()
+                                                    .children())>;
+  using type = decltype([]<size_t... i>(std::index_sequence<i...>) {
+    return std::tuple_cat(
+        typename subexpression_occurrences<
+            std::remove_cvref_t<std::tuple_element_t<i, Children>>,
+            std::index_sequence<path..., i>>::type{}...,
+        std::conditional_t<
+            is_shareable_v<T>,
+            std::tuple<Occurrence<T, std::index_sequence<path...>>>,
+            std::tuple<>>{});
+  }(std::make_index_sequence<std::tuple_size_v<Children>>{}));
+};
+
+// The types of subexpressions, that occur at least twice, in the order of the
+// first occurrence, as std::type_identity, and the paths of their occurrences.
+template <typename Occurrences> struct shared_subexpressions;
+template <typename... Occurrences>
+struct shared_subexpressions<std::tuple<Occurrences...>> {
+  template <typename T>
+  static constexpr size_t count =
+      (size_t(std::is_same_v<T, typename Occurrences::type>) + ... + 0);
+
+  template <size_t i>
+  using type_at =
+      typename std::tuple_element_t<i, std::tuple<Occurrences...>>::type;
+
+  template <size_t i> static constexpr bool is_first() {
+    return [&]<size_t... j>(std::index_sequence<j...>) {
+      return (!std::is_same_v<type_at<i>, type_at<j>> && ...);
+    }(std::make_index_sequence<i>{});
+  }
+
+  using types = decltype([]<size_t... i>(std::index_sequence<i...>) {
+    return std::tuple_cat(
+        std::conditional_t<is_first<i>() && count<type_at<i>> >= 2,
+                           std::tuple<std::type_identity<type_at<i>>>,
+                           std::tuple<>>{}...);
+  }(std::index_sequence_for<Occurrences...>{}));
+
+  template <typename T>
+  using paths = decltype(std::tuple_cat(
+      std::conditional_t<std::is_same_v<T, typename Occurrences::type>,
+                         std::tuple<typename Occurrences::path>,
+                         std::tuple<>>{}...));
+};
+
+// the index of T in the tuple of std::type_identity, or size_t(-1)
+template <typename T, typename Types> constexpr size_t slot_index_v = -1;
+template <typename T, typename... Types>
+constexpr size_t slot_index_v<T, std::tuple<std::type_identity<Types>...>> =
+    [] {
+      std::array<bool, sizeof...(Types)> is_same{std::is_same_v<T, Types>...};
+      for (size_t i = 0; i < is_same.size(); i++)
+        if (is_same[i])
+          return i;
+      return size_t(-1);
+    }();
+
+template <typename Path, size_t i> struct append_index;
+template <size_t... path, size_t i>
+struct append_index<std::index_sequence<path...>, i> {
+  using type = std::index_sequence<path..., i>;
+};
+
+// The state, with which the rewritten expression is evaluated: the shared
+// values, and the original expression with the state, for the nodes, that are
+// evaluated as they are.
+template <typename State, typename Root, typename Values, size_t n>
+struct SharedState {
+  const State &state;
+  const Root &root;
+  const Values &values;
+  const std::array<bool, n> &is_shared;
+};
+
+// The original node at Path, evaluated with the state.
+template <typename Path> struct SubexpressionAt : Symbol {
+  auto operator()(const auto &shared_state) const {
+    return node_at(shared_state.root, Path{})(shared_state.state);
+  }
+};
+
+// The value of the shared subexpression, if all of its occurrences are
+// identical (which is checked at runtime, since constants are compared),
+// and the subexpression otherwise.
+template <size_t slot, typename Subexpression>
+struct SharedSubexpression : Symbol {
+  Subexpression subexpression;
+  SharedSubexpression(Subexpression subexpression_)
+      : subexpression(subexpression_) {}
+  auto operator()(const auto &shared_state) const {
+    using Value =
+        std::remove_cvref_t<decltype(std::get<slot>(shared_state.values))>;
+    if (shared_state.is_shared[slot])
+      return std::get<slot>(shared_state.values);
+    return Value(subexpression(shared_state));
+  }
+};
+
+// The node of the same kind with other children.
+template <template <typename...> typename Node, typename... Args,
+          typename... Children>
+auto rebuild(std::type_identity<Node<Args...>>, Children... children) {
+  return Node<Children...>(children...);
+}
+
+// The expression T at Path, in which the shared subexpressions are replaced
+// with SharedSubexpression, and the other leaves with SubexpressionAt.
+template <typename T, typename Path, typename Slots, bool is_slot = true>
+auto rewrite_subexpressions() {
+  if constexpr (is_slot && slot_index_v<T, Slots> != size_t(-1)) {
+    auto subexpression = rewrite_subexpressions<T, Path, Slots, false>();
+    return SharedSubexpression<slot_index_v<T, Slots>, decltype(subexpression)>(
+        subexpression);
+  } else if constexpr (HasSubexpressions<T>) {
+    using Children =
+        std::remove_cvref_t<decltype(std::declval<const T &>().children())>;
+    return [&]<size_t... i>(std::index_sequence<i...>) {
+      return rebuild(
+          std::type_identity<T>{},
+          rewrite_subexpressions<
+              std::remove_cvref_t<std::tuple_element_t<i, Children>>,
+              typename append_index<Path, i>::type, Slots>()...);
+    }(std::make_index_sequence<std::tuple_size_v<Children>>{});
+  } else {
+    return SubexpressionAt<Path>{};
+  }
+}
+
+// Evaluation of the expression, in which the identical subexpressions are
+// evaluated once, i.e. `shared(expr, state)` is `expr(state)`, where
+// `shared` is SharedSubexpressions(expr). It does not hold the expression,
+// so it is not invalidated, when the expression is copied.
+template <typename Expr> struct SharedSubexpressions {
+  using Occurrences = shared_subexpressions<
+      typename subexpression_occurrences<Expr, std::index_sequence<>>::type>;
+  using Slots = typename Occurrences::types;
+  static constexpr size_t slots = std::tuple_size_v<Slots>;
+
+  template <size_t slot>
+  using slot_type = typename std::tuple_element_t<slot, Slots>::type;
+  template <size_t slot>
+  using slot_paths = typename Occurrences::template paths<slot_type<slot>>;
+
+  // whether all occurrences of the subexpression are identical
+  std::array<bool, slots> is_shared;
+
+  SharedSubexpressions(const Expr &expr) {
+    [&]<size_t... slot>(std::index_sequence<slot...>) {
+      ((is_shared[slot] = std::apply(
+            [&](auto first, auto... other) {
+              return (same_value(node_at(expr, first), node_at(expr, other)) &&
+                      ...);
+            },
+            slot_paths<slot>{})),
+       ...);
+    }(std::make_index_sequence<slots>{});
+  }
+
+  auto operator()(const Expr &expr, const auto &state) const {
+    if constexpr (slots == 0) {
+      return expr(state);
+    } else {
+      return [&]<size_t... slot>(std::index_sequence<slot...>) {
+        std::tuple<std::remove_cvref_t<
+            decltype(std::declval<const slot_type<slot> &>()(state))>...>
+            values;
+        SharedState shared_state{state, expr, values, is_shared};
+        // the subexpressions of a shared subexpression are before it
+        (
+            [&] {
+              if (is_shared[slot])
+                std::get<slot>(values) =
+                    rewrite_subexpressions<
+                        slot_type<slot>,
+                        std::tuple_element_t<0, slot_paths<slot>>, Slots,
+                        false>()(shared_state);
+            }(),
+            ...);
+        return rewrite_subexpressions<Expr, std::index_sequence<>, Slots>()(
+            shared_state);
+      }(std::make_index_sequence<slots>{});
+    }
+  }
+};
+
+} // namespace diffurch
@@ -3,31 +3,68 @@
 #include "operators.hpp"
 #include "symbol_types.hpp"
 
+#include "../statistics.hpp"
 #include "../util/find_root.hpp"
+#include <algorithm>
 #include <limits>
 
 namespace diffurch {
 
+// Zero of arg between state.t_prev and state.t_curr, found with root_finder
+// (see util/find_root.hpp), at which arg has the same sign as at t_curr.
+template <typename RootFinder>
+double locate_zero(const RootFinder &root_finder, const auto &arg,
+                   const auto &state) {
+  auto f = [&arg, &state](double t) {
+    state.count(&Statistics::root_finder_evaluations);
+    return arg(state, t);
+  };
+  if constexpr (RootFinder::uses_derivative) {
+    auto arg_derivative = D(arg);
+    auto df = [&arg_derivative, &state](double t) {
+      state.count(&Statistics::root_finder_evaluations);
+      return arg_derivative(state, t);
+    };
+    return root_finder(f, df, state.t_prev, state.t_curr);
+  } else {
+    return root_finder(f, state.t_prev, state.t_curr);
+  }
+}
+
+// The switch of a boolean expression. Unlike WhenZeroCross, it has no
+// RootFinder parameter: the other root finders (see util/find_root.hpp)
+// interpolate the values of a continuous function, and a boolean expression
+// has only the two values, so its switch is located by bisection.
 template <IsBoolSymbol Arg> struct WhenSwitch : DetectSymbol {
   Arg arg;
   WhenSwitch(Arg arg_) : arg(arg_) {};
 
+  double max_delay() const { return arg.max_delay(); }
+
   bool detect(const auto &state) const { return arg(state) != arg.prev(state); }
 
   double locate(const auto &state) const {
     if (detect(state)) {
       return bool_change_by_bisection(
-          [this, &state](double t) { return arg(state, t); }, state.t_prev,
-          state.t_curr);
+          [this, &state](double t) {
+            state.count(&Statistics::root_finder_evaluations);
+            return arg(state, t);
+          },
+          state.t_prev, state.t_curr);
     } else {
       return std::numeric_limits<double>::max();
     }
   }
 };
 
-template <IsSymbol Arg> struct WhenZeroCross : DetectSymbol {
+template <IsSymbol Arg, typename RootFinder = Bisection>
+struct WhenZeroCross : DetectSymbol {
   Arg arg;
-  WhenZeroCross(Arg arg_) : arg(arg_) {};
+  RootFinder root_finder;
+  WhenZeroCross(Arg arg_, RootFinder root_finder_ = RootFinder())
+      : arg(arg_), root_finder(root_finder_) {};
+
+  double max_delay() const { return arg.max_delay(); }
 
   bool detect(const auto &state) const {
     auto curr = arg(state);
@@ -47,53 +84,72 @@ template <IsSymbol Arg> struct WhenZeroCross : DetectSymbol {
 
   double locate(const auto &state) const {
     if (detect(state)) {
-      return root_by_bisection(
-          [this, &state](double t) { return arg(state, t); }, state.t_prev,
-          state.t_curr);
+      return locate_zero(root_finder, arg, state);
     } else {
       return std::numeric_limits<double>::max();
     }
   }
 };
 
-template <IsSymbol Arg> struct WhenZeroCrossFromBelow : DetectSymbol {
+template <IsSymbol Arg, typename RootFinder = Bisection>
+struct WhenZeroCrossFromBelow : DetectSymbol {
   Arg arg;
-  WhenZeroCrossFromBelow(Arg arg_) : arg(arg_) {};
+  RootFinder root_finder;
+  WhenZeroCrossFromBelow(Arg arg_, RootFinder root_finder_ = RootFinder())
+      : arg(arg_), root_finder(root_finder_) {};
+
+  double max_delay() const { return arg.max_delay(); }
+
   bool detect(const auto &state) const {
     return arg(state) >= 0 && arg.prev(state) < 0;
   }
   double locate(const auto &state) const {
     if (detect(state)) {
-      return root_by_bisection(
-          [this, &state](double t) { return arg(state, t); }, state.t_prev,
-          state.t_curr);
+      return locate_zero(root_finder, arg, state);
     } else {
       return std::numeric_limits<double>::max();
     }
   }
 };
-template <IsSymbol Arg> struct WhenZeroCrossFromAbove : DetectSymbol {
+template <IsSymbol Arg, typename RootFinder = Bisection>
+struct WhenZeroCrossFromAbove : DetectSymbol {
   Arg arg;
-  WhenZeroCrossFromAbove(Arg arg_) : arg(arg_) {};
+  RootFinder root_finder;
+  WhenZeroCrossFromAbove(Arg arg_, RootFinder root_finder_ = RootFinder())
+      : arg(arg_), root_finder(root_finder_) {};
+
+  double max_delay() const { return arg.max_delay(); }
+
   bool detect(const auto &state) const {
     return arg(state) <= 0 && arg.prev(state) > 0;
   }
   double locate(const auto &state) const {
     if (detect(state)) {
-      return root_by_bisection(
-          [this, &state](double t) { return arg(state, t); }, state.t_prev,
-          state.t_curr);
+      return locate_zero(root_finder, arg, state);
     } else {
       return std::numeric_limits<double>::max();
     }
   }
 };
 
-// support for When(x == 0) or When(x > 0) syntax
+// the root finders are called with the argument, and not with the state
+template <typename Arg, typename RootFinder>
+struct has_delayed_variable<WhenZeroCross<Arg, RootFinder>>
+    : has_delayed_variable<Arg> {};
+template <typename Arg, typename RootFinder>
+struct has_delayed_variable<WhenZeroCrossFromBelow<Arg, RootFinder>>
+    : has_delayed_variable<Arg> {};
+template <typename Arg, typename RootFinder>
+struct has_delayed_variable<WhenZeroCrossFromAbove<Arg, RootFinder>>
+    : has_delayed_variable<Arg> {};
+
+// support for When(x == 0) or When(x > 0) syntax, and for the choice of the
+// root finding method for event location, e.g. When(x == 0, Brent())
 #define STATE_CROSS_EVENT_FROM_COMP(comparison_operator, cross_event_type)     \
-  template <IsSymbol L, IsSymbol R>                                            \
-  auto When(const comparison_operator<L, R> &bool_expr) {                      \
-    return cross_event_type(bool_expr.l - bool_expr.r);                        \
+  template <IsSymbol L, IsSymbol R, typename RootFinder = Bisection>           \
+  auto When(const comparison_operator<L, R> &bool_expr,                        \
+            RootFinder root_finder = RootFinder()) {                           \
+    return cross_event_type(bool_expr.l - bool_expr.r, root_finder);           \
   }
 
 STATE_CROSS_EVENT_FROM_COMP(Equal, WhenZeroCross);
@@ -109,15 +165,17 @@ struct StateDetectWithLocationCondition : DetectSymbol {
   StateDetectWithLocationCondition(Event event_, Condition condition_)
       : event(event_), condition(condition_) {};
 
+  double max_delay() const {
+    return std::max(event.max_delay(), condition.max_delay());
+  }
+
   bool detect(const auto &state) const { return event.detect(state); }
 
-  bool locate(const auto &state) const {
+  double locate(const auto &state) const {
     if (!detect(state))
       return std::numeric_limits<double>::max();
 
-    double t =
-        root_by_bisection([this, &state](double t_) { return arg(state, t_); },
-                          state.t_prev, state.t_curr);
+    double t = event.locate(state);
     if (!condition(state, t))
       return std::numeric_limits<double>::max();
 
@@ -133,16 +191,19 @@ struct StateDetectWithDetectionCondition : DetectSymbol {
   StateDetectWithDetectionCondition(Event event_, Condition condition_)
       : event(event_), condition(condition_) {};
 
+  double max_delay() const {
+    return std::max(event.max_delay(), condition.max_delay());
+  }
+
   bool detect(const auto &state) const {
     return event.detect(state) && (condition(state) || condition.prev(state));
   }
 
-  bool locate(const auto &state) const {
+  double locate(const auto &state) const {
     if (!detect(state))
       return std::numeric_limits<double>::max();
 
-    return root_by_bisection([this, &state](double t) { return arg(state, t); },
-                             state.t_prev, state.t_curr);
+    return event.locate(state);
   }
 };
 
@@ -3,28 +3,39 @@
 #include "../util/math.hpp"
 #include "detect_symbols.hpp"
 #include "symbol_types.hpp"
+#include "variables.hpp"
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <limits>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace diffurch {
 
+template <IsSymbol Arg, IsSymbol Weight = Constant<double>> struct delta;
+
 template <IsSymbol Arg> struct dsign : Symbol {
   Arg arg;
   dsign(Arg arg_) : arg(arg_) {}
   double curr_value = 0;
   auto operator()(const auto &state) const { return curr_value; }
 
+  double max_delay() const { return arg.max_delay(); }
+
   template <size_t current_coordinate = size_t(-1)> auto get_events() {
-    return std::tuple_cat(arg.template get_events<current_coordinate>(),
-                          std::make_tuple(StartEvent(nullptr,
-                                                     [this](const auto &state) {
-                                                       curr_value =
-                                                           sign(arg(state));
-                                                     }),
-                                          Event(When(arg == 0), nullptr,
-                                                [this](const auto &state) {
-                                                  curr_value = -curr_value;
-                                                })));
+    return std::tuple_cat(
+        arg.template get_events<current_coordinate>(),
+        std::make_tuple(
+            StartEvent(nullptr,
+                       handler_reading(arg, [this](const auto &state) {
+                         curr_value = sign(arg(state));
+                       })),
+            Event(When(arg == 0), nullptr,
+                  handler_reading(Variable<>(), [this](const auto &state) {
+                    curr_value = -curr_value;
+                  }))));
   }
 };
 template <std::size_t derivative = 1, IsSymbol Arg>
@@ -34,6 +45,16 @@ constexpr auto D(const dsign<Arg> &sign_) {
   else
     return D<derivative - 1>(2 * delta(sign_.arg) * D(sign_.arg));
 }
+// The jumps are not included in the partial derivatives (e.g. in the
+// Jacobian), but they are included in the directional derivatives, that are
+// used for variational equations: the tangent vector jumps at the switch.
+template <typename Var, IsSymbol Arg>
+constexpr auto partial(const dsign<Arg> &sign_) {
+  if constexpr (is_direction_v<Var>)
+    return delta(sign_.arg, 2. * partial<Var>(sign_.arg));
+  else
+    return Zero();
+}
 
 template <IsSymbol Arg> struct dstep : Symbol {
   Arg arg;
@@ -47,17 +68,20 @@ template <IsSymbol Arg> struct dstep : Symbol {
 
   auto operator()(const auto &state) const { return curr_value; }
 
+  double max_delay() const { return arg.max_delay(); }
+
   template <size_t current_coordinate = size_t(-1)> auto get_events() {
     return std::tuple_cat(
         arg.template get_events<current_coordinate>(),
         std::make_tuple(
             StartEvent(nullptr,
-                       [this](const auto &state) {
+                       handler_reading(arg, [this](const auto &state) {
                          curr_value = step(arg(state), low_value, high_value);
-                       }),
-            Event(When(arg == 0), nullptr, [this](const auto &state) {
-              curr_value = step(arg(state), low_value, high_value);
-            })));
+                       })),
+            Event(When(arg == 0), nullptr,
+                  handler_reading(arg, [this](const auto &state) {
+                    curr_value = step(arg(state), low_value, high_value);
+                  }))));
   }
 };
 template <std::size_t derivative = 1, IsSymbol Arg>
@@ -68,6 +92,14 @@ constexpr auto D(const dstep<Arg> &step_) {
     return D<derivative - 1>((step_.high_value - step_.low_value) *
                              delta(step_.arg) * D(step_.arg));
 }
+template <typename Var, IsSymbol Arg>
+constexpr auto partial(const dstep<Arg> &step_) {
+  if constexpr (is_direction_v<Var>)
+    return delta(step_.arg, (step_.high_value - step_.low_value) *
+                                partial<Var>(step_.arg));
+  else
+    return Zero();
+}
 
 template <IsSymbol Arg> struct dabs : Symbol {
   Arg arg;
@@ -78,17 +110,20 @@ template <IsSymbol Arg> struct dabs : Symbol {
 
   auto operator()(const auto &state) const { return curr_sign * arg(state); }
 
+  double max_delay() const { return arg.max_delay(); }
+
   template <size_t current_coordinate = size_t(-1)> auto get_events() {
-    return std::tuple_cat(arg.template get_events<current_coordinate>(),
-                          std::make_tuple(StartEvent(nullptr,
-                                                     [this](const auto &state) {
-                                                       curr_sign =
-                                                           sign(arg(state));
-                                                     }),
-                                          Event(When(arg == 0), nullptr,
-                                                [this](const auto &state) {
-                                                  curr_sign = -curr_sign;
-                                                })));
+    return std::tuple_cat(
+        arg.template get_events<current_coordinate>(),
+        std::make_tuple(
+            StartEvent(nullptr,
+                       handler_reading(arg, [this](const auto &state) {
+                         curr_sign = sign(arg(state));
+                       })),
+            Event(When(arg == 0), nullptr,
+                  handler_reading(Variable<>(), [this](const auto &state) {
+                    curr_sign = -curr_sign;
+                  }))));
   }
 };
 template <std::size_t derivative = 1, IsSymbol Arg>
@@ -98,6 +133,12 @@ constexpr auto D(const dabs<Arg> &abs_) {
   else
     return D<derivative - 1>(dsign(abs_.arg) * D(abs_.arg));
 }
+// the sign is evaluated, since the copies of dsign in the derivative would not
+// be updated by events
+template <typename Var, IsSymbol Arg>
+constexpr auto partial(const dabs<Arg> &abs_) {
+  return sign(abs_.arg) * partial<Var>(abs_.arg);
+}
 
 template <IsSymbol Arg> struct drelu : Symbol {
   Arg arg;
@@ -108,16 +149,20 @@ template <IsSymbol Arg> struct drelu : Symbol {
 
   auto operator()(const auto &state) const { return curr_mask * arg(state); }
 
+  double max_delay() const { return arg.max_delay(); }
+
   template <size_t current_coordinate = size_t(-1)> auto get_events() {
     return std::tuple_cat(
         arg.template get_events<current_coordinate>(),
         std::make_tuple(
-            StartEvent(
-                nullptr,
-                [this](const auto &state) { curr_mask = step(arg(state)); }),
-            Event(When(arg == 0), nullptr, [this](const auto &state) {
-              curr_mask = 1. - curr_mask; // 1 -> 0; 0->1
-            })));
+            StartEvent(nullptr,
+                       handler_reading(arg, [this](const auto &state) {
+                         curr_mask = step(arg(state));
+                       })),
+            Event(When(arg == 0), nullptr,
+                  handler_reading(Variable<>(), [this](const auto &state) {
+                    curr_mask = 1. - curr_mask; // 1 -> 0; 0->1
+                  }))));
   }
 };
 template <std::size_t derivative = 1, IsSymbol Arg>
@@ -127,6 +172,10 @@ constexpr auto D(const drelu<Arg> &relu_) {
   else
     return D<derivative - 1>(dstep(relu_.arg) * D(relu_.arg));
 }
+template <typename Var, IsSymbol Arg>
+constexpr auto partial(const drelu<Arg> &relu_) {
+  return step(relu_.arg) * partial<Var>(relu_.arg);
+}
 
 template <IsBoolSymbol Condition, IsSymbol ExprIfTrue, IsSymbol ExprIfFalse>
 struct dpiecewise : Symbol {
@@ -145,18 +194,24 @@ struct dpiecewise : Symbol {
     return condition_value ? expr_if_true(state) : expr_if_false(state);
   }
 
+  double max_delay() const {
+    return std::max({condition.max_delay(), expr_if_true.max_delay(),
+                     expr_if_false.max_delay()});
+  }
+
   template <size_t current_coordinate = size_t(-1)> auto get_events() {
     return std::tuple_cat(
         expr_if_true.template get_events<current_coordinate>(),
         expr_if_false.template get_events<current_coordinate>(),
         std::make_tuple(
             StartEvent(nullptr,
-                       [this](const auto &state) {
+                       handler_reading(condition, [this](const auto &state) {
                          condition_value = condition(state);
-                       }),
-            Event(WhenSwitch(condition), nullptr, [this](const auto &state) {
-              condition_value = condition(state);
-            })));
+                       })),
+            Event(WhenSwitch(condition), nullptr,
+                  handler_reading(condition, [this](const auto &state) {
+                    condition_value = condition(state);
+                  }))));
   }
 };
 
@@ -181,41 +236,157 @@ template <IsSymbol Arg> struct dclip : Symbol {
     }
   }
 
+  double max_delay() const { return arg.max_delay(); }
+
   template <size_t current_coordinate = size_t(-1)> auto get_events() {
     return std::tuple_cat(
         arg.template get_events<current_coordinate>(),
         std::make_tuple(
             StartEvent(nullptr,
-                       [this](const auto &state) {
+                       handler_reading(arg, [this](const auto &state) {
                          auto val = arg(state);
                          idx = (val > min_value) + (val >= max_value);
-                       }),
-            Event(
-                When(arg == min_value), nullptr,
-                [this](const auto &state) { idx = (arg(state) > min_value); }),
-            Event(When(arg == max_value), nullptr, [this](const auto &state) {
-              idx = 1 + (arg(state) >= max_value);
-            })));
+                       })),
+            Event(When(arg == min_value), nullptr,
+                  handler_reading(arg, [this](const auto &state) {
+                    idx = (arg(state) > min_value);
+                  })),
+            Event(When(arg == max_value), nullptr,
+                  handler_reading(arg, [this](const auto &state) {
+                    idx = 1 + (arg(state) >= max_value);
+                  }))));
   }
 };
 
-template <IsSymbol Arg> struct delta : Symbol {
+// Dirac delta function of arg, multiplied by weight, i.e. the coordinate of
+// Vector, in which it is a summand, jumps by weight / |D(arg)| at the zero
+// crossings of arg. For example, D(dsign(x)) = 2 * delta(x) * D(x) jumps by
+// 2 sign(D(x)), which is the jump of dsign(x). The factors of the products
+// with delta are moved into weight (see the operators below), so that they
+// are included in the jump.
+template <IsSymbol Arg, IsSymbol Weight> struct delta : Symbol {
   Arg arg;
-  delta(Arg arg_) : arg(arg_) {}
+  Weight weight;
+  delta(Arg arg_, Weight weight_ = Weight(1.)) : arg(arg_), weight(weight_) {}
+
+  // the jump at the located zero crossing, which is computed in locate, since
+  // D(arg) is evaluated with the step, that contains the crossing
+  double jump = 0.;
 
   auto operator()(const auto &state) const { return 0.; }
   auto operator()(const auto &state, double t) const { return 0.; }
   auto operator()(double t) const { return 0.; }
   auto prev(const auto &state) const { return 0.; }
 
+  double max_delay() const {
+    return std::max(arg.max_delay(), weight.max_delay());
+  }
+
+  struct Detection : DetectSymbol {
+    delta *self;
+    WhenZeroCross<Arg> when_zero;
+
+    double max_delay() const { return self->max_delay(); }
+    bool detect(const auto &state) const { return when_zero.detect(state); }
+    double locate(const auto &state) const {
+      double t = when_zero.locate(state);
+      if (t < std::numeric_limits<double>::max())
+        self->jump =
+            self->weight(state, t) / std::abs(D(self->arg)(state, t));
+      return t;
+    }
+  };
+
   template <size_t current_coordinate = size_t(-1)> auto get_events() {
     return std::tuple_cat(
-        arg.get_events(),
-        std::make_tuple(Event(When(arg == 0), nullptr, [this](auto &state) {
-          state.x_curr[current_coordinate] =
-              state.x_prev[current_coordinate] + 1 / abs(D(arg)(state));
-        })));
+        arg.template get_events<current_coordinate>(),
+        weight.template get_events<current_coordinate>(),
+        std::make_tuple(Event(
+            Detection{{}, this, WhenZeroCross<Arg>(arg)}, nullptr,
+            handler_reading(Variable<>(), [this](auto &state) {
+              state.x_curr[current_coordinate] =
+                  state.x_prev[current_coordinate] + jump;
+            }))));
   }
 };
+template <size_t derivative = 1, IsSymbol Arg, IsSymbol Weight>
+constexpr auto D(const delta<Arg, Weight> &delta_) {
+  static_assert(derivative == 0, "derivatives of delta are not defined");
+  return delta_;
+}
+template <typename Var, IsSymbol Arg, IsSymbol Weight>
+constexpr auto partial(const delta<Arg, Weight> &) {
+  return Zero();
+}
+
+// Whether the expression contains delta, in which case the products with it
+// are expanded, and their factors are moved into the weights of delta.
+template <typename T> struct has_delta : std::false_type {};
+template <template <typename...> typename Node, typename... Args>
+struct has_delta<Node<Args...>>
+    : std::bool_constant<(has_delta<Args>::value || ...)> {};
+template <IsSymbol Arg, IsSymbol Weight>
+struct has_delta<delta<Arg, Weight>> : std::true_type {};
+template <typename T>
+inline constexpr bool has_delta_v = has_delta<std::decay_t<T>>::value;
+
+template <typename T>
+concept HasDelta = IsSymbol<T> && has_delta_v<T>;
+
+// applies op to the weights of delta, and to the other summands
+template <IsSymbol Expr>
+  requires(!has_delta_v<Expr>)
+auto scale_delta(const Expr &expr, const auto &op) {
+  return op(expr);
+}
+template <IsSymbol Arg, IsSymbol Weight>
+auto scale_delta(const delta<Arg, Weight> &delta_, const auto &op) {
+  return delta(delta_.arg, op(delta_.weight));
+}
+template <IsSymbol L, IsSymbol R>
+  requires has_delta_v<Add<L, R>>
+auto scale_delta(const Add<L, R> &add, const auto &op) {
+  return scale_delta(add.l, op) + scale_delta(add.r, op);
+}
+template <IsSymbol L, IsSymbol R>
+  requires has_delta_v<Sub<L, R>>
+auto scale_delta(const Sub<L, R> &sub, const auto &op) {
+  return scale_delta(sub.l, op) - scale_delta(sub.r, op);
+}
+
+template <HasDelta Expr, IsSymbol Factor>
+  requires(!has_delta_v<Factor>)
+auto operator*(Expr expr, Factor factor) {
+  return scale_delta(expr, [&](const auto &w) { return w * factor; });
+}
+template <IsSymbol Factor, HasDelta Expr>
+  requires(!has_delta_v<Factor>)
+auto operator*(Factor factor, Expr expr) {
+  return scale_delta(expr, [&](const auto &w) { return factor * w; });
+}
+template <HasDelta Expr, IsNotSymbol Factor>
+auto operator*(Expr expr, Factor &&factor) {
+  return expr * Constant(std::forward<Factor>(factor));
+}
+template <IsNotSymbol Factor, HasDelta Expr>
+auto operator*(Factor &&factor, Expr expr) {
+  return Constant(std::forward<Factor>(factor)) * expr;
+}
+template <HasDelta Expr, IsSymbol Factor>
+  requires(!has_delta_v<Factor>)
+auto operator/(Expr expr, Factor factor) {
+  return scale_delta(expr, [&](const auto &w) { return w / factor; });
+}
+template <HasDelta Expr, IsNotSymbol Factor>
+auto operator/(Expr expr, Factor &&factor) {
+  return expr / Constant(std::forward<Factor>(factor));
+}
+template <HasDelta Expr> auto operator-(Expr expr) {
+  return scale_delta(expr, [](const auto &w) { return -w; });
+}
+template <IsSymbol L, HasDelta R> auto operator-(L l, R r) { return l + (-r); }
+template <IsNotSymbol L, HasDelta R> auto operator-(L &&l, R r) {
+  return Constant(std::forward<L>(l)) + (-r);
+}
 
 } // namespace diffurch
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "symbol_types.hpp"
+#include "variables.hpp"
+#include "vector.hpp"
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace diffurch {
+
+// The variables, with respect to which the partial derivatives are taken.
+template <typename Var> constexpr bool is_partial_variable_v = false;
+template <> constexpr bool is_partial_variable_v<TimeVariable> = true;
+template <size_t coordinate>
+constexpr bool is_partial_variable_v<Variable<coordinate, 0>> =
+    coordinate != size_t(-1);
+
+// Partial derivative with respect to Var, e.g. D<Variable<1>>(x * y) is x,
+// and D<decltype(y)>(x * y) is the same. Unlike D<order>(expr), which is the
+// derivative along the solution, the other variables are held constant.
+template <typename Var, IsSymbol Expr>
+  requires is_partial_variable_v<std::remove_cvref_t<Var>>
+constexpr auto D(const Expr &expr) {
+  return partial<std::remove_cvref_t<Var>>(expr);
+}
+
+// Matrix of expressions, given by the rows (Vector expressions), which is
+// evaluated to std::array of the values of the rows.
+template <IsSymbol... Rows> struct Matrix {
+  std::tuple<Rows...> rows;
+
+  Matrix(Rows... rows_) : rows(rows_...) {}
+  const auto &children() const { return rows; }
+
+  auto operator()(const auto &state) const {
+    return std::apply(
+        [&](const auto &...row) {
+          using Row = decltype(std::get<0>(rows)(state));
+          return std::array<Row, sizeof...(Rows)>{row(state)...};
+        },
+        rows);
+  }
+};
+
+// Vector of the partial derivatives of the expression with respect to the
+// variables x_0, ..., x_{n-1}.
+template <size_t n, IsSymbol Expr> auto gradient(const Expr &expr) {
+  return [&]<size_t... j>(std::index_sequence<j...>) {
+    return Vector(partial<Variable<j>>(expr)...);
+  }(std::make_index_sequence<n>{});
+}
+
+// Jacobian matrix of the right hand side, i.e. the matrix of partial
+// derivatives d rhs_i / d x_j, which is evaluated as
+// jacobian(rhs)(state)[i][j]. The delayed variables are held constant.
+template <IsSymbol... Coordinates>
+auto jacobian(const Vector<Coordinates...> &rhs) {
+  return std::apply(
+      [](const auto &...coordinates) {
+        return Matrix(gradient<sizeof...(Coordinates)>(coordinates)...);
+      },
+      rhs.coordinates);
+}
+
+} // namespace diffurch
@@ -2,6 +2,8 @@
 
 #include "../util/math.hpp"
 #include "symbol_types.hpp"
+#include "variables.hpp"
+#include <algorithm>
 #include <math.h>
 #include <tuple>
 
@@ -11,6 +13,7 @@ namespace diffurch {
   template <IsSymbol Arg> struct Function_##func : Symbol {                    \
     Arg arg;                                                                   \
     Function_##func(Arg arg_) : arg(arg_) {}                                   \
+    auto children() const { return std::tie(arg); }                            \
     auto operator()(const auto &state) const { return func(arg(state)); }      \
     auto operator()(const auto &state, double t) const {                       \
       return func(arg(state, t));                                              \
@@ -20,14 +23,22 @@ namespace diffurch {
     template <size_t current_coordinate = size_t(-1)> auto get_events() {      \
       return arg.template get_events<current_coordinate>();                    \
     }                                                                          \
+    double max_delay() const { return arg.max_delay(); }                       \
   };                                                                           \
-  template <IsSymbol Arg> auto func(Arg arg) { return Function_##func(arg); }  \
+  template <IsSymbol Arg> auto func(Arg arg) {                                \
+    return Function_##func<Arg>(arg);                                          \
+  }                                                                            \
   template <size_t derivative = 1, IsSymbol Arg>                               \
-  constexpr auto D(const Function_##func<Arg> &func) {                         \
+  constexpr auto D(const Function_##func<Arg> &function) {                     \
     if constexpr (derivative == 0)                                             \
-      return func;                                                             \
+      return function;                                                         \
     else                                                                       \
-      return D<derivative - 1>(func_derivative(func.arg)) * D(func.arg);       \
+      return D<derivative - 1>(func_derivative(function.arg)) *                \
+             D(function.arg);                                                  \
+  }                                                                            \
+  template <typename Var, IsSymbol Arg>                                        \
+  constexpr auto partial(const Function_##func<Arg> &function) {               \
+    return func_derivative(function.arg) * partial<Var>(function.arg);         \
   }
 
 #define STATE_FUNCTION_OVERLOAD_2(func)                                        \
@@ -35,6 +46,7 @@ namespace diffurch {
     Arg1 arg1;                                                                 \
     Arg2 arg2;                                                                 \
     Function_##func(Arg1 arg1_, Arg2 arg2_) : arg1(arg1_), arg2(arg2_) {}      \
+    auto children() const { return std::tie(arg1, arg2); }                     \
     auto operator()(const auto &state) const {                                 \
       return func(arg1(state), arg2(state));                                   \
     }                                                                          \
@@ -49,6 +61,9 @@ namespace diffurch {
       return std::tuple_cat(arg1.template get_events<current_coordinate>(),    \
                             arg2.template get_events<current_coordinate>());   \
     }                                                                          \
+    double max_delay() const {                                                 \
+      return std::max(arg1.max_delay(), arg2.max_delay());                     \
+    }                                                                          \
   };                                                                           \
   template <IsSymbol Arg1, IsSymbol Arg2> auto func(Arg1 arg1, Arg2 arg2) {    \
     return Function_##func(arg1, arg2);                                        \
@@ -71,15 +86,32 @@ STATE_FUNCTION_OVERLOAD(log10,
 STATE_FUNCTION_OVERLOAD(log2,
                         [](const auto &x) { return 1 / (x * std::log(2.)); });
 
-STATE_FUNCTION_OVERLOAD(sign, [](auto...) { return 0.; });
+STATE_FUNCTION_OVERLOAD(sign, [](auto...) { return Zero(); });
 STATE_FUNCTION_OVERLOAD(abs, sign);
 STATE_FUNCTION_OVERLOAD(relu, step);
-STATE_FUNCTION_OVERLOAD(step, [](auto...) { return 0.; });
+STATE_FUNCTION_OVERLOAD(step, [](auto...) { return Zero(); });
 
 using ::std::pow;
 STATE_FUNCTION_OVERLOAD_2(pow);
 STATE_FUNCTION_OVERLOAD_2(atan2);
 
+template <typename Var, IsSymbol Arg1, IsSymbol Arg2>
+constexpr auto partial(const Function_pow<Arg1, Arg2> &f) {
+  return f.arg2 * pow(f.arg1, f.arg2 - 1.) * partial<Var>(f.arg1) +
+         f * log(f.arg1) * partial<Var>(f.arg2);
+}
+// constant exponent, for which log(arg1) is not evaluated (it is nan for the
+// negative base)
+template <typename Var, IsSymbol Arg1, IsNotSymbol T>
+constexpr auto partial(const Function_pow<Arg1, Constant<T>> &f) {
+  return f.arg2.value * pow(f.arg1, f.arg2.value - 1.) * partial<Var>(f.arg1);
+}
+template <typename Var, IsSymbol Arg1, IsSymbol Arg2>
+constexpr auto partial(const Function_atan2<Arg1, Arg2> &f) {
+  return (f.arg2 * partial<Var>(f.arg1) - f.arg1 * partial<Var>(f.arg2)) /
+         (f.arg1 * f.arg1 + f.arg2 * f.arg2);
+}
+
 template <IsSymbol Arg, typename Callable> struct state_function : Symbol {
 
   Arg arg;
@@ -96,6 +128,7 @@ template <IsSymbol Arg, typename Callable> struct state_function : Symbol {
   template <size_t current_coordinate = size_t(-1)> auto get_events() {
     return arg.template get_events<current_coordinate>();
   }
+  double max_delay() const { return arg.max_delay(); }
 };
 
 } // namespace diffurch
@@ -1,12 +1,26 @@
 #pragma once
 
 #include "../events.hpp"
+#include "../util/type_traits.hpp"
 #include "symbol_types.hpp"
+#include "variables.hpp"
+#include <algorithm>
+#include <limits>
 #include <math.h>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
 namespace diffurch {
 
+// The nodes are simplified, when they are built by the operators: the zeros
+// and ones known at compile time (see StaticConstant), which come from
+// differentiation, are folded, and the constants are merged. The overloads of
+// fold_constants for the arithmetic nodes are below. The runtime values of
+// Constant are not compared with zero and one, so the type of the expression
+// does not depend on them.
+template <typename Node> auto fold_constants(const Node &node) { return node; }
+
 #define STATE_OPERATOR_OVERLOAD(op, op_name, argument_class, base_class)       \
   template <Is##argument_class L, Is##argument_class R>                        \
   struct op_name : base_class {                                                \
@@ -14,6 +28,7 @@ namespace diffurch {
     R r;                                                                       \
                                                                                \
     op_name(L l_, R r_) : l(l_), r(r_) {};                                     \
+    auto children() const { return std::tie(l, r); }                           \
                                                                                \
     auto operator()(const auto &state) const { return l(state) op r(state); }  \
     auto prev(const auto &state) const {                                       \
@@ -27,24 +42,28 @@ namespace diffurch {
       return std::tuple_cat(l.template get_events<current_coordinate>(),       \
                             r.template get_events<current_coordinate>());      \
     }                                                                          \
+    double max_delay() const {                                                 \
+      return std::max(l.max_delay(), r.max_delay());                           \
+    }                                                                          \
   };                                                                           \
   template <Is##argument_class L, Is##argument_class R>                        \
   auto operator op(L l, R r) {                                                 \
-    return op_name(l, r);                                                      \
+    return fold_constants(op_name(l, r));                                      \
   }                                                                            \
   template <IsNot##argument_class L, Is##argument_class R>                     \
   auto operator op(L &&l, R r) {                                               \
-    return op_name(Constant(std::forward<L>(l)), r);                           \
+    return fold_constants(op_name(Constant(std::forward<L>(l)), r));           \
   }                                                                            \
   template <Is##argument_class L, IsNot##argument_class R>                     \
   auto operator op(L l, R &&r) {                                               \
-    return op_name(l, Constant(std::forward<R>(r)));                           \
+    return fold_constants(op_name(l, Constant(std::forward<R>(r))));           \
   }
 
 #define STATE_UNARY_OPERATOR_OVERLOAD(op, op_name, argument_class, base_class) \
   template <Is##argument_class Arg> struct op_name : base_class {              \
     Arg arg;                                                                   \
     op_name(Arg arg_) : arg(arg_) {}                                           \
+    auto children() const { return std::tie(arg); }                            \
     auto operator()(const auto &state) const { return op(arg(state)); }        \
     auto operator()(const auto &state, double t) const {                       \
       return op(arg(state, t));                                                \
@@ -54,22 +73,99 @@ namespace diffurch {
     template <size_t current_coordinate = size_t(-1)> auto get_events() {      \
       return arg.template get_events<current_coordinate>();                    \
     }                                                                          \
+    double max_delay() const { return arg.max_delay(); }                       \
   };                                                                           \
   template <Is##argument_class Arg> auto operator op(Arg arg) {                \
-    return op_name(arg);                                                       \
+    return fold_constants(op_name<Arg>(arg));                                  \
   }
 
+// The node of two constants, which is evaluated at compile time, if both
+// are StaticConstant (adding 0. turns -0. into 0., so that there is one Zero),
+// and at runtime otherwise.
+#define FOLD_CONSTANTS(op, l, r)                                               \
+  [&] {                                                                        \
+    if constexpr (is_static_constant_v<L> && is_static_constant_v<R>)          \
+      return StaticConstant<(L::value op R::value) + 0.>();                    \
+    else                                                                       \
+      return Constant(l.value op r.value);                                     \
+  }()
+
 STATE_OPERATOR_OVERLOAD(+, Add, Symbol, Symbol);
+template <IsSymbol L, IsSymbol R> auto fold_constants(const Add<L, R> &add) {
+  if constexpr (std::is_same_v<L, Zero>)
+    return add.r;
+  else if constexpr (std::is_same_v<R, Zero>)
+    return add.l;
+  else if constexpr (is_constant_v<L> && is_constant_v<R>)
+    return FOLD_CONSTANTS(+, add.l, add.r);
+  else
+    return add;
+}
 template <size_t derivative = 1, IsSymbol L, IsSymbol R>
 constexpr auto D(const Add<L, R> &add) {
   return D<derivative>(add.l) + D<derivative>(add.r);
 }
+template <typename Var, IsSymbol L, IsSymbol R>
+constexpr auto partial(const Add<L, R> &add) {
+  return partial<Var>(add.l) + partial<Var>(add.r);
+}
 STATE_OPERATOR_OVERLOAD(-, Sub, Symbol, Symbol);
+template <IsSymbol L, IsSymbol R> auto fold_constants(const Sub<L, R> &sub) {
+  if constexpr (std::is_same_v<R, Zero>)
+    return sub.l;
+  else if constexpr (std::is_same_v<L, Zero>)
+    return -sub.r;
+  else if constexpr (is_constant_v<L> && is_constant_v<R>)
+    return FOLD_CONSTANTS(-, sub.l, sub.r);
+  else
+    return sub;
+}
 template <size_t derivative = 1, IsSymbol L, IsSymbol R>
 constexpr auto D(const Sub<L, R> &sub) {
   return D<derivative>(sub.l) - D<derivative>(sub.r);
 }
+template <typename Var, IsSymbol L, IsSymbol R>
+constexpr auto partial(const Sub<L, R> &sub) {
+  return partial<Var>(sub.l) - partial<Var>(sub.r);
+}
+
+// delays of the form `t - tau`, `t + tau`, `(t - tau1) - tau2`, etc.
+template <IsSymbol L, IsNotSymbol T>
+constexpr double time_lag(const Sub<L, Constant<T>> &sub) {
+  return time_lag(sub.l) + sub.r.value;
+}
+template <IsSymbol L, IsNotSymbol T>
+constexpr double time_lag(const Add<L, Constant<T>> &add) {
+  return time_lag(add.l) - add.r.value;
+}
+template <IsNotSymbol T, IsSymbol R>
+constexpr double time_lag(const Add<Constant<T>, R> &add) {
+  return time_lag(add.r) - add.l.value;
+}
+template <IsNotSymbol T, IsNotSymbol U>
+constexpr double time_lag(const Add<Constant<T>, Constant<U>> &) {
+  return std::numeric_limits<double>::infinity();
+}
 STATE_OPERATOR_OVERLOAD(*, Mul, Symbol, Symbol);
+// the constant factors are merged, if they are on the left, e.g.
+// `2. * (3. * x)` is `6. * x`
+template <IsSymbol L, IsSymbol R> auto fold_constants(const Mul<L, R> &mul) {
+  if constexpr (std::is_same_v<L, Zero> || std::is_same_v<R, Zero>)
+    return Zero();
+  else if constexpr (std::is_same_v<L, One>)
+    return mul.r;
+  else if constexpr (std::is_same_v<R, One>)
+    return mul.l;
+  else if constexpr (is_constant_v<L> && is_constant_v<R>)
+    return FOLD_CONSTANTS(*, mul.l, mul.r);
+  else if constexpr (is_constant_v<L> && is_kind_of_v<R, Mul>) {
+    if constexpr (is_constant_v<std::remove_cvref_t<decltype(mul.r.l)>>)
+      return (mul.l * mul.r.l) * mul.r.r;
+    else
+      return mul;
+  } else
+    return mul;
+}
 template <size_t derivative = 1, IsSymbol L, IsSymbol R>
 constexpr auto D(const Mul<L, R> &mul) {
   if constexpr (derivative == 0)
@@ -77,8 +173,23 @@ constexpr auto D(const Mul<L, R> &mul) {
   else
     return D<derivative - 1>(D(mul.l) * mul.r + mul.l * D(mul.r));
 }
+template <typename Var, IsSymbol L, IsSymbol R>
+constexpr auto partial(const Mul<L, R> &mul) {
+  return partial<Var>(mul.l) * mul.r + mul.l * partial<Var>(mul.r);
+}
 
 STATE_OPERATOR_OVERLOAD(/, Div, Symbol, Symbol);
+template <IsSymbol L, IsSymbol R> auto fold_constants(const Div<L, R> &div) {
+  if constexpr (std::is_same_v<R, One>)
+    return div.l;
+  else if constexpr (std::is_same_v<L, Zero> && !std::is_same_v<R, Zero>)
+    return Zero();
+  else if constexpr (is_constant_v<L> && is_constant_v<R> &&
+                     !std::is_same_v<R, Zero>)
+    return FOLD_CONSTANTS(/, div.l, div.r);
+  else
+    return div;
+}
 template <size_t derivative = 1, IsSymbol L, IsSymbol R>
 constexpr auto D(const Div<L, R> &div) {
   if constexpr (derivative == 0)
@@ -87,12 +198,33 @@ constexpr auto D(const Div<L, R> &div) {
     return D<derivative - 1>((D(div.l) * div.r - div.l * D(div.r)) /
                              (div.r * div.r));
 }
+template <typename Var, IsSymbol L, IsSymbol R>
+constexpr auto partial(const Div<L, R> &div) {
+  return (partial<Var>(div.l) * div.r - div.l * partial<Var>(div.r)) /
+         (div.r * div.r);
+}
 
 STATE_UNARY_OPERATOR_OVERLOAD(-, Neg, Symbol, Symbol);
+template <IsSymbol Arg> auto fold_constants(const Neg<Arg> &neg) {
+  if constexpr (is_static_constant_v<Arg>)
+    return StaticConstant<-Arg::value + 0.>();
+  else if constexpr (is_constant_v<Arg>)
+    return Constant(-neg.arg.value);
+  else if constexpr (is_kind_of_v<Arg, Neg>)
+    return neg.arg.arg;
+  else
+    return neg;
+}
+
+#undef FOLD_CONSTANTS
 template <size_t derivative = 1, IsSymbol Arg>
 constexpr auto D(const Neg<Arg> &neg) {
   return -D<derivative>(neg.arg);
 }
+template <typename Var, IsSymbol Arg>
+constexpr auto partial(const Neg<Arg> &neg) {
+  return -partial<Var>(neg.arg);
+}
 
 // UNARY PLUS is NoOp
 template <IsSymbol Arg> auto operator+(Arg arg) { return arg; }
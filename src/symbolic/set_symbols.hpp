@@ -4,6 +4,7 @@
 #include "symbol_types.hpp"
 
 #include "../util/find_root.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <limits>
 #include <tuple>
@@ -14,9 +15,15 @@ template <size_t coordinate, IsSymbol R> struct EventSetVariable : SetSymbol {
   R r;
   EventSetVariable(const Variable<coordinate, 0> &var, R r_) : r(r_) {};
 
+  double max_delay() const { return r.max_delay(); }
+
   void operator()(auto &state) { state.x_curr[coordinate] = r.prev(state); }
 };
 
+template <size_t coordinate, IsSymbol R>
+struct has_delayed_variable<EventSetVariable<coordinate, R>>
+    : has_delayed_variable<R> {};
+
 template <size_t coordinate, IsSymbol R>
 auto operator<<(const Variable<coordinate, 0> &var, const R &r) {
   return EventSetVariable(var, r);
@@ -32,6 +39,14 @@ template <IsSetSymbol... SetExpr> struct SetMultiple : SetSymbol {
       : set_expr_tuple(std::make_tuple(set_exprs...)) {};
   SetMultiple(const std::tuple<SetExpr...> &t_) : set_expr_tuple(t_) {};
 
+  double max_delay() const {
+    return std::apply(
+        [](const auto &...set_exprs) {
+          return std::max({0., set_exprs.max_delay()...});
+        },
+        set_expr_tuple);
+  }
+
   void operator()(auto &state) {
     [this, &state]<size_t... Is>(std::index_sequence<Is...>) {
       (std::get<Is>(set_expr_tuple)(state), ...);
@@ -1,11 +1,18 @@
 #pragma once
 
+#include <limits>
 #include <type_traits>
 
 namespace diffurch {
 
+// By default, a symbol is assumed to access the whole past of the state,
+// see the max_delay member function of symbols.
 #define DECLARE_STATE_EXPRESSION_TYPE(NAME)                                    \
-  struct NAME {};                                                              \
+  struct NAME {                                                                \
+    static constexpr double max_delay() {                                      \
+      return std::numeric_limits<double>::infinity();                          \
+    }                                                                          \
+  };                                                                           \
                                                                                \
   template <typename T>                                                        \
   concept Is##NAME = std::is_base_of_v<NAME, std::decay_t<T>>;                 \
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "symbol_types.hpp"
+#include <algorithm>
 #include <cstddef> // for size_t
+#include <limits>
 #include <tuple>
+#include <type_traits>
 
 namespace diffurch {
 
@@ -23,16 +26,90 @@ template <IsNotSymbol T = double> struct Constant : Symbol {
   template <size_t coordinate = -1> static auto get_events() {
     return std::make_tuple();
   }
+  static constexpr double max_delay() { return 0.; }
 };
 
+// Constant, whose value is known at compile time. The derivatives of
+// constants are Zero, and the expressions with static constants are
+// simplified, when they are built (see fold_constants in operators.hpp), so
+// that e.g. `D(x(t - 1.))` is `D(x)(t - 1.)` and not
+// `D(x)(t - 1.) * (1. - 0.)`.
+template <double value_> struct StaticConstant : Symbol {
+  static constexpr double value = value_;
+
+  constexpr operator double() const { return value; }
+
+  static constexpr double operator()([[maybe_unused]] const auto &state) {
+    return value;
+  }
+  static constexpr double prev([[maybe_unused]] const auto &state) {
+    return value;
+  }
+  static constexpr double operator()([[maybe_unused]] const auto &state,
+                                     [[maybe_unused]] double t) {
+    return value;
+  }
+  static constexpr double operator()([[maybe_unused]] double t) {
+    return value;
+  }
+  template <size_t coordinate = -1> static auto get_events() {
+    return std::make_tuple();
+  }
+  static constexpr double max_delay() { return 0.; }
+};
+using Zero = StaticConstant<0.>;
+using One = StaticConstant<1.>;
+
+template <typename T> constexpr bool is_static_constant_v = false;
+template <double value>
+constexpr bool is_static_constant_v<StaticConstant<value>> = true;
+
+// Whether T is Constant or StaticConstant, i.e. it does not depend on the
+// state and time.
+template <typename T> constexpr bool is_constant_v = is_static_constant_v<T>;
+template <IsNotSymbol T> constexpr bool is_constant_v<Constant<T>> = true;
+
 template <size_t derivative_order = 1, IsNotSymbol T = double>
-constexpr Constant<T> D(const Constant<T> &c) {
+constexpr auto D(const Constant<T> &c) {
   if constexpr (derivative_order == 0) {
     return c;
   } else {
-    return Constant<T>(0);
+    return Zero();
   }
 }
+template <size_t derivative_order = 1, double value>
+constexpr auto D(const StaticConstant<value> &c) {
+  if constexpr (derivative_order == 0) {
+    return c;
+  } else {
+    return Zero();
+  }
+}
+
+// Partial derivatives of the expressions with respect to Var, which is
+// TimeVariable or Variable<j>, where the other variables (and the past of the
+// state) are held constant. They are used for the Jacobian of the right hand
+// side (see jacobian.hpp).
+//
+// For Var = Direction<offset>, it is the derivative in the direction of the
+// variables x_{offset + j}, i.e. the linearization, in which each x_j (also
+// delayed, or differentiated) is replaced with x_{offset + j}, which is used
+// for the variational equations (see lyapunov.hpp).
+template <size_t offset_> struct Direction {
+  static constexpr size_t offset = offset_;
+};
+template <typename Var> constexpr bool is_direction_v = false;
+template <size_t offset>
+constexpr bool is_direction_v<Direction<offset>> = true;
+
+template <typename Var, IsNotSymbol T = double>
+constexpr auto partial(const Constant<T> &) {
+  return Zero();
+}
+template <typename Var, double value>
+constexpr auto partial(const StaticConstant<value> &) {
+  return Zero();
+}
 
 struct TimeVariable : Symbol {
   static auto operator()(const auto &state) { return state.t_curr; }
@@ -44,34 +121,55 @@ struct TimeVariable : Symbol {
   template <size_t coordinate = size_t(-1)> static auto get_events() {
     return std::make_tuple();
   }
+  static constexpr double max_delay() { return 0.; }
 };
 
 template <size_t derivative_order = 1> constexpr auto D(const TimeVariable &t) {
   if constexpr (derivative_order == 0) {
     return t;
   } else if constexpr (derivative_order == 1) {
-    return Constant(1.);
+    return One();
   } else {
-    return Constant(0.);
+    return Zero();
   }
 }
 
+template <typename Var> constexpr auto partial(const TimeVariable &) {
+  return StaticConstant<std::is_same_v<Var, TimeVariable> ? 1. : 0.>();
+}
+
+// The delay `t - arg(t)` of the argument of a delayed variable. It is only
+// known when the argument is of the form `t - tau` (or `t + tau`, or a sum of
+// several constants), otherwise it is infinity (e.g. state dependent delays).
+template <IsSymbol Arg> constexpr double time_lag(const Arg &) {
+  return std::numeric_limits<double>::infinity();
+}
+constexpr double time_lag(const TimeVariable &) { return 0.; }
+
 template <size_t coordinate, IsSymbol Arg, size_t derivative_order = 0>
 struct VariableAt : Symbol {
   Arg arg;
+  // the step, where the previous evaluation took place, see State::eval
+  mutable size_t hint = 0;
+
   VariableAt(Arg arg_) : arg(arg_) {}
   auto operator()(const auto &state) const {
-    return state.template eval<derivative_order>(arg(state))[coordinate];
+    return state.template eval<derivative_order, coordinate>(arg(state), hint);
   }
   auto prev(const auto &state) const {
-    return state.template eval<derivative_order>(arg.prev(state))[coordinate];
+    return state.template eval<derivative_order, coordinate>(arg.prev(state),
+                                                             hint);
   }
   auto operator()(const auto &state, double t) const {
-    return state.template eval<derivative_order>(arg(state, t))[coordinate];
+    return state.template eval<derivative_order, coordinate>(arg(state, t),
+                                                             hint);
   }
   template <size_t current_coordinate = size_t(-1)> auto get_events() {
     return arg.template get_events<current_coordinate>();
   }
+  double max_delay() const {
+    return std::max({0., time_lag(arg), arg.max_delay()});
+  }
 };
 
 template <size_t derivative_order = 1, size_t var_coordinate = -1,
@@ -82,15 +180,52 @@ D(const VariableAt<var_coordinate, VarArg, var_derivative> &var_at) {
     return var_at;
   } else {
     return D<derivative_order - 1>(
-        Variable<var_coordinate, var_derivative + 1>(var_at.arg) *
+        VariableAt<var_coordinate, VarArg, var_derivative + 1>(var_at.arg) *
         D(var_at.arg));
   }
 }
 
-template <size_t coordinate = -1, size_t derivative_order = 0>
+// Compile time check, whether the type of an expression (or of anything that
+// holds expressions in its template arguments, like events) contains a delayed
+// variable, i.e. whether the past of the state is ever evaluated.
+//
+// The callables, that are not symbols and do not declare max_delay (e.g. the
+// lambdas in event handlers or in state_function), may evaluate the past in a
+// way that is not seen from their types, so they are assumed to do so (see
+// handler_reading in events/primitives.hpp to declare what they read).
+namespace detail {
+struct CallOperator {
+  void operator()();
+};
+template <typename T> struct WithCallOperator : T, CallOperator {};
+// whether T has any operator(), also a template one (e.g. of generic lambdas),
+// in which case the name is ambiguous in WithCallOperator<T>
+template <typename T>
+concept HasCallOperator = std::is_class_v<T> && !std::is_final_v<T> &&
+                          !requires { &WithCallOperator<T>::operator(); };
+} // namespace detail
+template <typename T>
+inline constexpr bool is_opaque_callable_v =
+    std::is_function_v<std::remove_pointer_t<T>> ||
+    (detail::HasCallOperator<T> && !std::is_base_of_v<Symbol, T> &&
+     !std::is_base_of_v<BoolSymbol, T> && !std::is_base_of_v<DetectSymbol, T> &&
+     !std::is_base_of_v<SetSymbol, T> && !requires { &T::max_delay; });
+template <typename T>
+struct has_delayed_variable : std::bool_constant<is_opaque_callable_v<T>> {};
+template <template <typename...> typename Node, typename... Args>
+struct has_delayed_variable<Node<Args...>>
+    : std::bool_constant<(has_delayed_variable<Args>::value || ...)> {};
+template <size_t coordinate, IsSymbol Arg, size_t derivative_order>
+struct has_delayed_variable<VariableAt<coordinate, Arg, derivative_order>>
+    : std::true_type {};
+template <typename T>
+inline constexpr bool has_delayed_variable_v =
+    has_delayed_variable<std::decay_t<T>>::value;
+
+template <size_t coordinate = size_t(-1), size_t derivative_order = 0>
 struct Variable : Symbol {
   static auto operator()(const IsNotSymbol auto &state, double t) {
-    return state.template eval<derivative_order>(t)[coordinate];
+    return state.template eval<derivative_order, coordinate>(t);
   }
 
   static auto operator()(IsSymbol auto arg) {
@@ -100,6 +235,7 @@ struct Variable : Symbol {
   template <size_t current_coordinate = size_t(-1)> static auto get_events() {
     return std::make_tuple();
   }
+  static constexpr double max_delay() { return 0.; }
 };
 
 template <size_t coordinate> struct Variable<coordinate, 0> : Symbol {
@@ -116,10 +252,7 @@ template <size_t coordinate> struct Variable<coordinate, 0> : Symbol {
       return state.x_prev[coordinate];
   }
   static auto operator()(const IsNotSymbol auto &state, double t) {
-    if constexpr (coordinate == -1)
-      return state.template eval<0>(t);
-    else
-      return state.template eval<0>(t)[coordinate];
+    return state.template eval<0, coordinate>(t);
   }
 
   static auto operator()(IsSymbol auto arg) {
@@ -129,6 +262,7 @@ template <size_t coordinate> struct Variable<coordinate, 0> : Symbol {
   template <size_t current_coordinate = size_t(-1)> static auto get_events() {
     return std::make_tuple();
   }
+  static constexpr double max_delay() { return 0.; }
 };
 
 template <size_t derivative_order = 1, size_t var_coordinate = -1,
@@ -137,6 +271,60 @@ constexpr auto D(const Variable<var_coordinate, var_derivative> &var) {
   return Variable<var_coordinate, var_derivative + derivative_order>();
 }
 
+template <typename Var, size_t var_coordinate, size_t var_derivative>
+constexpr auto partial(const Variable<var_coordinate, var_derivative> &) {
+  static_assert(var_coordinate != size_t(-1),
+                "partial derivatives of the vector variable are not defined");
+  if constexpr (is_direction_v<Var>) {
+    return Variable<Var::offset + var_coordinate, var_derivative>();
+  } else {
+    static_assert(var_derivative == 0, "partial derivatives with respect to "
+                                       "the state of the derivatives of the "
+                                       "state are not defined");
+    return StaticConstant<
+        std::is_same_v<Var, Variable<var_coordinate>> ? 1. : 0.>();
+  }
+}
+
+// Compile time check, whether the expression depends on the state, and not
+// only on time (e.g. the argument t - tau of a delayed variable does not).
+template <typename T> struct has_state_variable : std::false_type {};
+template <template <typename...> typename Node, typename... Args>
+struct has_state_variable<Node<Args...>>
+    : std::bool_constant<(has_state_variable<Args>::value || ...)> {};
+template <size_t coordinate, size_t derivative_order>
+struct has_state_variable<Variable<coordinate, derivative_order>>
+    : std::true_type {};
+template <size_t coordinate, IsSymbol Arg, size_t derivative_order>
+struct has_state_variable<VariableAt<coordinate, Arg, derivative_order>>
+    : std::true_type {};
+template <typename T>
+inline constexpr bool has_state_variable_v =
+    has_state_variable<std::decay_t<T>>::value;
+
+// the past of the state is held constant, but the argument can depend on the
+// current state (e.g. state dependent delays)
+template <typename Var, size_t var_coordinate, IsSymbol VarArg,
+          size_t var_derivative>
+constexpr auto
+partial(const VariableAt<var_coordinate, VarArg, var_derivative> &var_at) {
+  auto argument_term = [&] {
+    if constexpr (std::is_same_v<Var, TimeVariable> ||
+                  has_state_variable_v<VarArg>)
+      return VariableAt<var_coordinate, VarArg, var_derivative + 1>(
+                 var_at.arg) *
+             partial<Var>(var_at.arg);
+    else
+      return Zero();
+  }();
+  if constexpr (is_direction_v<Var>)
+    return VariableAt<Var::offset + var_coordinate, VarArg, var_derivative>(
+               var_at.arg) +
+           argument_term;
+  else
+    return argument_term;
+}
+
 template <size_t N, size_t from = 0, size_t to = N, size_t derivative_order = 0>
 constexpr auto Variables() {
   if constexpr (from == to) {
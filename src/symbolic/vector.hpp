@@ -2,8 +2,10 @@
 
 #include "symbol_types.hpp"
 #include "variables.hpp"
+#include <algorithm>
 #include <cstddef> // for size_t
 #include <tuple>
+#include <type_traits>
 
 namespace diffurch {
 
@@ -14,29 +16,34 @@ template <IsSymbol... Coordinates> struct Vector : Symbol {
       : coordinates(std::make_tuple(coordinates_...)) {};
   Vector(std::tuple<Coordinates...> coordinates_)
       : coordinates(coordinates_) {};
+  const auto &children() const { return coordinates; }
+
+  // std::array of the common type of the values of coordinates, which is
+  // double, unless they are evaluated with other value types (e.g. Lanes, see
+  // batch.hpp)
+  static auto make_array(const auto &...values) {
+    using Value = std::common_type_t<double, std::decay_t<decltype(values)>...>;
+    return std::array<Value, sizeof...(values)>{Value(values)...};
+  }
 
   auto operator()(const auto &state) const {
     return [&]<size_t... Is>(std::index_sequence<Is...>) {
-      return std::array<double, sizeof...(Coordinates)>{
-          std::get<Is>(coordinates)(state)...};
+      return make_array(std::get<Is>(coordinates)(state)...);
     }(std::make_index_sequence<sizeof...(Coordinates)>{});
   }
   auto operator()(const auto &state, double t) const {
     return [&]<size_t... Is>(std::index_sequence<Is...>) {
-      return std::array<double, sizeof...(Coordinates)>{
-          std::get<Is>(coordinates)(state, t)...};
+      return make_array(std::get<Is>(coordinates)(state, t)...);
     }(std::make_index_sequence<sizeof...(Coordinates)>{});
   }
   auto operator()(double t) const {
     return [&]<size_t... Is>(std::index_sequence<Is...>) {
-      return std::array<double, sizeof...(Coordinates)>{
-          std::get<Is>(coordinates)(t)...};
+      return make_array(std::get<Is>(coordinates)(t)...);
     }(std::make_index_sequence<sizeof...(Coordinates)>{});
   }
   auto prev(const auto &state) const {
     return [&]<size_t... Is>(std::index_sequence<Is...>) {
-      return std::array<double, sizeof...(Coordinates)>{
-          std::get<Is>(coordinates).prev(state)...};
+      return make_array(std::get<Is>(coordinates).prev(state)...);
     }(std::make_index_sequence<sizeof...(Coordinates)>{});
   }
   auto get_events() {
@@ -45,6 +52,13 @@ template <IsSymbol... Coordinates> struct Vector : Symbol {
           std::get<Is>(coordinates).template get_events<Is>()...);
     }(std::make_index_sequence<sizeof...(Coordinates)>{});
   }
+  double max_delay() const {
+    return std::apply(
+        [](const auto &...coordinates_) {
+          return std::max({0., coordinates_.max_delay()...});
+        },
+        coordinates);
+  }
 };
 
 template <IsSymbol L, IsSymbol R> auto operator|(L l, R r) {
@@ -65,11 +79,22 @@ constexpr auto D(const Vector<Coordinates...> &vector) {
     return vector;
   } else {
     return std::apply(
-        [&](const auto &...coordinates) { return Vector(D(coordinates)...); },
+        [&](const auto &...coordinates) {
+          return Vector(D<derivative>(coordinates)...);
+        },
         vector.coordinates);
   }
 }
 
+template <typename Var, IsSymbol... Coordinates>
+constexpr auto partial(const Vector<Coordinates...> &vector) {
+  return std::apply(
+      [&](const auto &...coordinates) {
+        return Vector(partial<Var>(coordinates)...);
+      },
+      vector.coordinates);
+}
+
 template <IsSymbol L, IsSymbol R> auto operator&(L l, R r) {
   return std::make_tuple(l, r);
 }
@@ -1,46 +1,33 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <utility>
 
 namespace diffurch {
 
-#ifdef DEBUG
-#define DEBUG_ASSERT(x) assert(x)
-#else
-#define DEBUG_ASSERT(x)
-#endif
-
-template <typename F, typename T>
-inline T root_by_bisection(const F &f, T l, T r) {
-  DEBUG_ASSERT(
-      f(l) * f(h) <= 0 &&
-      "Endpoints don't have the opposite signes in root_by_bisection_method");
-
-  if (f(l) > 0)
-    std::swap(l, r); // such that f(l) < 0 < f(r)
-
-  T m;
-  for (int i = 0; i < 50; i++) {
-    m = (l + r) * 0.5;
-    if (f(m) < 0) {
-      l = m;
-    } else {
-      r = m;
-    }
-  }
-  // return m;
-  return std::max(r, l);
+// Whether the root finding can be stopped, because the bracket [l, r] is not
+// longer than tolerance, or it can not be divided further in floating point
+// arithmetic.
+inline bool is_bracket_small(double l, double r, double tolerance) {
+  double m = (l + r) * 0.5;
+  return std::abs(r - l) <= tolerance || m == l || m == r;
 }
 
+// The point in [l, r], at which the boolean f changes its value, found by
+// bisection; the later end of the final bracket is returned.
 template <typename F, typename T>
-inline T bool_change_by_bisection(const F &f, T l, T r) {
+inline T bool_change_by_bisection(const F &f, T l, T r,
+                                  double tolerance = 0.) {
 
   if (f(l))
     std::swap(l, r); // such that f(l) == false, f(r) == true
 
   T m;
   for (int i = 0; i < 50; i++) {
+    if (is_bracket_small(l, r, tolerance))
+      break;
     m = (l + r) * 0.5;
     if (f(m)) {
       r = m;
@@ -52,4 +39,204 @@ inline T bool_change_by_bisection(const F &f, T l, T r) {
   return std::max(r, l);
 }
 
+// Root finding methods for event location.
+//
+// A method is called as method(f, l, r), or as method(f, df, l, r) if
+// method.uses_derivative is true, where f(l) and f(r) have opposite signs or
+// f(r) == 0. The returned point lies within the final bracket at the side of
+// r, that is, f has the same sign there as at r (or is zero), so that the
+// event is still detected at the returned time. The iterations stop, when the
+// bracket is shorter than tolerance (see is_bracket_small). If f(l) and f(r)
+// have the same sign (which happens, when the event is detected by the values
+// of the step, but the interpolation does not change its sign), r is returned.
+
+// Bisection, the most robust method, that needs up to 50 evaluations.
+struct Bisection {
+  static constexpr bool uses_derivative = false;
+  double tolerance = 0.;
+
+  template <typename F> double operator()(const F &f, double l, double r) const {
+    double fl = f(l);
+    double fr = f(r);
+    if (fr == 0 || (fl > 0) == (fr > 0))
+      return r;
+
+    for (int i = 0; i < 50; i++) {
+      if (is_bracket_small(l, r, tolerance))
+        break;
+      double m = (l + r) * 0.5;
+      double fm = f(m);
+      if (fm == 0 || (fm > 0) == (fr > 0))
+        r = m;
+      else
+        l = m;
+    }
+    return r;
+  }
+};
+
+// Regula falsi with the Illinois modification: the value at the end of the
+// bracket that is retained twice in a row is halved, which gives superlinear
+// convergence of both ends of the bracket.
+struct Illinois {
+  static constexpr bool uses_derivative = false;
+  double tolerance = 0.;
+
+  template <typename F> double operator()(const F &f, double l, double r) const {
+    double fl = f(l);
+    double fr = f(r);
+    if (fr == 0 || (fl > 0) == (fr > 0))
+      return r;
+
+    int retained = 0; // -1 if l was retained in the last iteration, +1 if r
+    for (int i = 0; i < 100; i++) {
+      if (is_bracket_small(l, r, tolerance))
+        break;
+
+      double m = (l * fr - r * fl) / (fr - fl);
+      if (!(m > std::min(l, r) && m < std::max(l, r)))
+        m = (l + r) * 0.5;
+
+      double fm = f(m);
+      if (fm == 0)
+        return m;
+
+      if ((fm > 0) == (fr > 0)) {
+        r = m;
+        fr = fm;
+        if (retained == -1)
+          fl *= 0.5;
+        retained = -1;
+      } else {
+        l = m;
+        fl = fm;
+        if (retained == 1)
+          fr *= 0.5;
+        retained = 1;
+      }
+    }
+    return r;
+  }
+};
+
+// Brent's method: inverse quadratic interpolation and secant steps, that fall
+// back to bisection, when they do not reduce the bracket fast enough.
+struct Brent {
+  static constexpr bool uses_derivative = false;
+  double tolerance = 0.;
+
+  template <typename F> double operator()(const F &f, double l, double r) const {
+    double a = l, b = r, c = l;
+    double fa = f(a), fb = f(b), fc = fa;
+    if (fb == 0 || (fa > 0) == (fb > 0))
+      return b;
+    bool r_is_positive = fb > 0;
+
+    double d = b - a, e = d;
+    for (int i = 0; i < 100; i++) {
+      if ((fb > 0) == (fc > 0)) { // b and c must bracket the root
+        c = a;
+        fc = fa;
+        d = e = b - a;
+      }
+      if (std::abs(fc) < std::abs(fb)) { // b is the best approximation
+        a = b;
+        b = c;
+        c = a;
+        fa = fb;
+        fb = fc;
+        fc = fa;
+      }
+
+      double tol =
+          0.5 * tolerance + std::numeric_limits<double>::epsilon() * std::abs(b);
+      double m = (c - b) * 0.5;
+      if (std::abs(m) <= tol || fb == 0 || is_bracket_small(b, c, tolerance))
+        break;
+
+      if (std::abs(e) < tol || std::abs(fa) <= std::abs(fb)) {
+        d = e = m; // bisection
+      } else {
+        double p, q, s = fb / fa;
+        if (a == c) { // secant
+          p = 2 * m * s;
+          q = 1 - s;
+        } else { // inverse quadratic interpolation
+          double qa = fa / fc, rb = fb / fc;
+          p = s * (2 * m * qa * (qa - rb) - (b - a) * (rb - 1));
+          q = (qa - 1) * (rb - 1) * (s - 1);
+        }
+        if (p > 0)
+          q = -q;
+        else
+          p = -p;
+
+        if (2 * p < std::min(3 * m * q - std::abs(tol * q), std::abs(e * q))) {
+          e = d;
+          d = p / q;
+        } else {
+          d = e = m;
+        }
+      }
+
+      a = b;
+      fa = fb;
+      b += std::abs(d) > tol ? d : (m > 0 ? tol : -tol);
+      fb = f(b);
+    }
+
+    if (fb == 0 || (fb > 0) == r_is_positive)
+      return b;
+    else
+      return c;
+  }
+};
+
+// Newton's method, safeguarded by bisection. It is efficient, when the
+// derivative is cheap to compute, e.g. for symbolic expressions, which are
+// differentiated with D.
+struct Newton {
+  static constexpr bool uses_derivative = true;
+  double tolerance = 0.;
+
+  template <typename F, typename DF>
+  double operator()(const F &f, const DF &df, double l, double r) const {
+    double fl = f(l);
+    double fr = f(r);
+    if (fr == 0 || (fl > 0) == (fr > 0))
+      return r;
+    double direction = r > l ? 1. : -1.; // from l to r
+
+    double x = std::abs(fl) < std::abs(fr) ? l : r;
+    double fx = std::abs(fl) < std::abs(fr) ? fl : fr;
+
+    for (int i = 0; i < 100; i++) {
+      if (is_bracket_small(l, r, tolerance))
+        break;
+      double tol = std::max(tolerance, std::numeric_limits<double>::epsilon() *
+                                           std::max(std::abs(l), std::abs(r)));
+
+      double x_new = x - fx / df(x);
+      // when newton step is small, the root is bracketed from the other side
+      // of x by a step of the length of tolerance
+      if (std::abs(x_new - x) < tol) {
+        bool x_is_at_r_side = (fx > 0) == (fr > 0);
+        x_new = x + (x_is_at_r_side ? -tol : tol) * direction;
+      }
+      if (!(x_new > std::min(l, r) && x_new < std::max(l, r)))
+        x_new = (l + r) * 0.5;
+
+      x = x_new;
+      fx = f(x);
+      if (fx == 0)
+        return x;
+      if ((fx > 0) == (fr > 0))
+        r = x;
+      else
+        l = x;
+    }
+    return r;
+  }
+};
+
 } // namespace diffurch
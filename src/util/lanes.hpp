@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+
+namespace diffurch {
+
+// Pack of W doubles, with elementwise arithmetic and math functions, that is
+// used as the value type of the symbolic expressions to evaluate W
+// trajectories at once (see batch.hpp). The operations are plain loops over
+// the lanes of fixed length, which compilers vectorize to SIMD instructions
+// (e.g. W = 4 for AVX2 and W = 8 for AVX-512, with -march=native).
+// The alignment is the size of the pack rounded up to a power of two, so any
+// W is allowed (e.g. W = 3 for three trajectories).
+template <size_t W> struct alignas(std::bit_ceil(sizeof(double) * W)) Lanes {
+  static constexpr size_t width = W;
+  std::array<double, W> lanes;
+
+  Lanes() = default;
+  // the same value in all lanes
+  Lanes(double value) { lanes.fill(value); }
+  Lanes(const std::array<double, W> &lanes_) : lanes(lanes_) {}
+
+  double &operator[](size_t i) { return lanes[i]; }
+  const double &operator[](size_t i) const { return lanes[i]; }
+
+  bool operator==(const Lanes &) const = default;
+};
+
+#define LANES_OPERATOR_OVERLOAD(op)                                            \
+  template <size_t W>                                                          \
+  Lanes<W> operator op(const Lanes<W> &lhs, const Lanes<W> &rhs) {             \
+    Lanes<W> result;                                                           \
+    for (size_t i = 0; i < W; i++)                                             \
+      result[i] = lhs[i] op rhs[i];                                            \
+    return result;                                                             \
+  }                                                                            \
+  template <size_t W> Lanes<W> operator op(const Lanes<W> &lhs, double rhs) {  \
+    Lanes<W> result;                                                           \
+    for (size_t i = 0; i < W; i++)                                             \
+      result[i] = lhs[i] op rhs;                                               \
+    return result;                                                             \
+  }                                                                            \
+  template <size_t W> Lanes<W> operator op(double lhs, const Lanes<W> &rhs) {  \
+    Lanes<W> result;                                                           \
+    for (size_t i = 0; i < W; i++)                                             \
+      result[i] = lhs op rhs[i];                                               \
+    return result;                                                             \
+  }                                                                            \
+  template <size_t W>                                                          \
+  Lanes<W> &operator op##=(Lanes<W> &lhs, const Lanes<W> &rhs) {               \
+    for (size_t i = 0; i < W; i++)                                             \
+      lhs[i] op## = rhs[i];                                                    \
+    return lhs;                                                                \
+  }
+
+LANES_OPERATOR_OVERLOAD(+)
+LANES_OPERATOR_OVERLOAD(-)
+LANES_OPERATOR_OVERLOAD(*)
+LANES_OPERATOR_OVERLOAD(/)
+#undef LANES_OPERATOR_OVERLOAD
+
+template <size_t W> Lanes<W> operator-(const Lanes<W> &arg) {
+  Lanes<W> result;
+  for (size_t i = 0; i < W; i++)
+    result[i] = -arg[i];
+  return result;
+}
+
+template <size_t W> Lanes<W> operator+(const Lanes<W> &arg) { return arg; }
+
+#define LANES_FUNCTION_OVERLOAD(func)                                          \
+  template <size_t W> Lanes<W> func(const Lanes<W> &arg) {                     \
+    Lanes<W> result;                                                           \
+    for (size_t i = 0; i < W; i++)                                             \
+      result[i] = std::func(arg[i]);                                           \
+    return result;                                                             \
+  }
+
+LANES_FUNCTION_OVERLOAD(sin)
+LANES_FUNCTION_OVERLOAD(cos)
+LANES_FUNCTION_OVERLOAD(tan)
+LANES_FUNCTION_OVERLOAD(exp)
+LANES_FUNCTION_OVERLOAD(log)
+LANES_FUNCTION_OVERLOAD(log10)
+LANES_FUNCTION_OVERLOAD(log2)
+LANES_FUNCTION_OVERLOAD(sqrt)
+LANES_FUNCTION_OVERLOAD(abs)
+#undef LANES_FUNCTION_OVERLOAD
+
+#define LANES_FUNCTION_OVERLOAD_2(func)                                        \
+  template <size_t W>                                                          \
+  Lanes<W> func(const Lanes<W> &arg1, const Lanes<W> &arg2) {                  \
+    Lanes<W> result;                                                           \
+    for (size_t i = 0; i < W; i++)                                             \
+      result[i] = std::func(arg1[i], arg2[i]);                                 \
+    return result;                                                             \
+  }                                                                            \
+  template <size_t W> Lanes<W> func(const Lanes<W> &arg1, double arg2) {       \
+    Lanes<W> result;                                                           \
+    for (size_t i = 0; i < W; i++)                                             \
+      result[i] = std::func(arg1[i], arg2);                                    \
+    return result;                                                             \
+  }                                                                            \
+  template <size_t W> Lanes<W> func(double arg1, const Lanes<W> &arg2) {       \
+    Lanes<W> result;                                                           \
+    for (size_t i = 0; i < W; i++)                                             \
+      result[i] = std::func(arg1, arg2[i]);                                    \
+    return result;                                                             \
+  }
+
+LANES_FUNCTION_OVERLOAD_2(pow)
+LANES_FUNCTION_OVERLOAD_2(atan2)
+#undef LANES_FUNCTION_OVERLOAD_2
+
+} // namespace diffurch
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vec.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+namespace diffurch {
+
+template <size_t N> using Mat = std::array<Vec<N>, N>;
+
+// LU decomposition with partial pivoting. The matrix A is replaced with the
+// factors L (below the diagonal, the unit diagonal is not stored) and U, such
+// that the row i of L U is the row pivots[i] of the original matrix. Returns
+// false, if the matrix is singular.
+template <size_t N> bool lu_decompose(Mat<N> &A, std::array<size_t, N> &pivots) {
+  for (size_t i = 0; i < N; i++)
+    pivots[i] = i;
+  for (size_t k = 0; k < N; k++) {
+    size_t p = k;
+    for (size_t i = k + 1; i < N; i++)
+      if (std::abs(A[i][k]) > std::abs(A[p][k]))
+        p = i;
+    if (A[p][k] == 0.)
+      return false;
+    std::swap(A[k], A[p]);
+    std::swap(pivots[k], pivots[p]);
+    for (size_t i = k + 1; i < N; i++) {
+      A[i][k] /= A[k][k];
+      for (size_t j = k + 1; j < N; j++)
+        A[i][j] -= A[i][k] * A[k][j];
+    }
+  }
+  return true;
+}
+
+// Solution of A x = b, where LU and pivots are computed by lu_decompose(A).
+template <size_t N>
+Vec<N> lu_solve(const Mat<N> &LU, const std::array<size_t, N> &pivots,
+                const Vec<N> &b) {
+  Vec<N> x;
+  for (size_t i = 0; i < N; i++) {
+    x[i] = b[pivots[i]];
+    for (size_t j = 0; j < i; j++)
+      x[i] -= LU[i][j] * x[j];
+  }
+  for (size_t i = N; i-- > 0;) {
+    for (size_t j = i + 1; j < N; j++)
+      x[i] -= LU[i][j] * x[j];
+    x[i] /= LU[i][i];
+  }
+  return x;
+}
+
+} // namespace diffurch
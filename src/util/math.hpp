@@ -1,4 +1,8 @@
 #pragma once
+#include "vec.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <math.h>
 
 namespace diffurch {
@@ -24,4 +28,21 @@ template <typename T> constexpr auto periodic_continuation(T a, T b, auto F) {
   };
 }
 
+// The initial condition function F, whose first derivative (see State::eval)
+// is approximated by the second order backward difference, which uses only
+// the values of F up to t. It is needed for the initial functions without
+// eval, when the right hand side uses the derivatives of delayed variables.
+template <typename F> struct BackwardDifference {
+  F f;
+
+  auto operator()(double t) const { return f(t); }
+
+  template <size_t derivative_order>
+    requires(derivative_order == 1)
+  auto eval(double t) const {
+    double h = 1e-5 * std::max(1., std::abs(t));
+    return (1.5 / h) * f(t) - (2. / h) * f(t - h) + (0.5 / h) * f(t - 2. * h);
+  }
+};
+
 } // namespace diffurch
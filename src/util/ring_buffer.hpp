@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace diffurch {
+
+// Queue with random access, stored in one contiguous block of memory.
+// Elements are appended with push_back and removed with pop_front, so that
+// the storage is reused, and reallocation only happens when the number of
+// stored elements exceeds the capacity (which is then doubled).
+template <typename T> class RingBuffer {
+private:
+  std::vector<T> data;
+  size_t head = 0;  // position of the front element in data
+  size_t count = 0; // number of stored elements
+
+  // capacity is always a power of two, so the wrap-around is a bit mask
+  size_t wrap(size_t i) const { return i & (data.size() - 1); }
+
+  void grow() {
+    std::vector<T> new_data(data.empty() ? 16 : 2 * data.size());
+    for (size_t i = 0; i < count; i++) {
+      new_data[i] = std::move((*this)[i]);
+    }
+    data = std::move(new_data);
+    head = 0;
+  }
+
+public:
+  using value_type = T;
+
+  RingBuffer() = default;
+  RingBuffer(std::initializer_list<T> list) {
+    for (const auto &e : list)
+      push_back(e);
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  size_t capacity() const { return data.size(); }
+
+  // i-th element counting from the front
+  T &operator[](size_t i) { return data[wrap(head + i)]; }
+  const T &operator[](size_t i) const { return data[wrap(head + i)]; }
+
+  T &front() { return (*this)[0]; }
+  const T &front() const { return (*this)[0]; }
+  T &back() { return (*this)[count - 1]; }
+  const T &back() const { return (*this)[count - 1]; }
+
+  void push_back(const T &value) {
+    if (count == data.size())
+      grow();
+    data[wrap(head + count)] = value;
+    count++;
+  }
+
+  void pop_front() {
+    head = wrap(head + 1);
+    count--;
+  }
+
+  void clear() {
+    head = 0;
+    count = 0;
+  }
+};
+
+} // namespace diffurch
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace diffurch {
+
+// Pool of threads, that calls a function for the indices 0, ..., n-1 in
+// parallel. The indices are split into contiguous ranges, one for each worker,
+// and a worker, that has finished its range, steals the upper half of the
+// remaining range of another worker. This way, the load stays balanced, when
+// the tasks take very different time (e.g. the integration of trajectories
+// with adaptive stepsize), while the cost of scheduling is small, when they do
+// not. The calling thread is one of the workers.
+class ThreadPool {
+public:
+  explicit ThreadPool(
+      size_t num_threads = std::max(1u, std::thread::hardware_concurrency()))
+      : ranges(std::make_unique<Range[]>(std::max<size_t>(num_threads, 1))),
+        num_workers(std::max<size_t>(num_threads, 1)) {
+    for (size_t worker = 1; worker < num_workers; worker++) {
+      threads.emplace_back([this, worker] { wait_and_work(worker); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    start.notify_all();
+    threads.clear(); // joins the threads before the members are destroyed
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t size() const { return num_workers; }
+
+  // Calls f(i) for i = 0, ..., n-1, and returns, when all calls are finished.
+  // Calls for different i can run simultaneously in different threads. If a
+  // call throws, the indices, that are not started yet, are skipped, and the
+  // first exception is rethrown, when the started calls are finished.
+  template <typename F> void for_each_index(size_t n, const F &f) {
+    std::function<void(size_t)> function = [&f](size_t i) { f(i); };
+    {
+      std::lock_guard lock(mutex);
+      task = &function;
+      cancelled = false;
+      for (size_t worker = 0; worker < num_workers; worker++) {
+        std::lock_guard range_lock(ranges[worker].mutex);
+        ranges[worker].begin = n * worker / num_workers;
+        ranges[worker].end = n * (worker + 1) / num_workers;
+      }
+      running = num_workers - 1;
+      generation++;
+    }
+    start.notify_all();
+
+    work(0);
+
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this] { return running == 0; });
+    task = nullptr;
+    if (exception)
+      std::rethrow_exception(std::exchange(exception, nullptr));
+  }
+
+private:
+  struct alignas(64) Range {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  std::unique_ptr<Range[]> ranges;
+  size_t num_workers;
+  std::vector<std::jthread> threads;
+
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  const std::function<void(size_t)> *task = nullptr;
+  size_t generation = 0;
+  size_t running = 0; // number of threads, that did not finish the task
+  std::exception_ptr exception; // the first exception thrown by the task
+  // set by cancel before the ranges are emptied, and checked under the lock of
+  // a range before an index is taken from it, or a stolen range is put in it
+  std::atomic<bool> cancelled = false;
+  bool stopping = false;
+
+  void wait_and_work(size_t worker) {
+    size_t last_generation = 0;
+    while (true) {
+      {
+        std::unique_lock lock(mutex);
+        start.wait(lock, [&] {
+          return stopping || generation != last_generation;
+        });
+        if (stopping)
+          return;
+        last_generation = generation;
+      }
+
+      work(worker);
+
+      {
+        std::lock_guard lock(mutex);
+        running--;
+      }
+      done.notify_one();
+    }
+  }
+
+  void work(size_t worker) {
+    size_t index;
+    while (pop(worker, index) || (steal(worker) && pop(worker, index))) {
+      try {
+        (*task)(index);
+      } catch (...) {
+        cancel(std::current_exception());
+      }
+    }
+  }
+
+  // keeps the first exception, and empties the ranges of all workers, so that
+  // no more calls are started
+  void cancel(std::exception_ptr thrown) {
+    {
+      std::lock_guard lock(mutex);
+      if (!exception)
+        exception = thrown;
+    }
+    cancelled = true;
+    for (size_t worker = 0; worker < num_workers; worker++) {
+      std::lock_guard lock(ranges[worker].mutex);
+      ranges[worker].begin = ranges[worker].end;
+    }
+  }
+
+  bool pop(size_t worker, size_t &index) {
+    std::lock_guard lock(ranges[worker].mutex);
+    if (cancelled || ranges[worker].begin == ranges[worker].end)
+      return false;
+    index = ranges[worker].begin++;
+    return true;
+  }
+
+  // moves the upper half of the range of some other worker to the empty range
+  // of this worker; returns false, if all ranges are empty, or the task is
+  // cancelled (cancel may empty both ranges between the two locks, and then
+  // the stolen range must not be put back)
+  bool steal(size_t worker) {
+    for (size_t shift = 1; shift < num_workers; shift++) {
+      Range &victim = ranges[(worker + shift) % num_workers];
+      size_t begin, end;
+      {
+        std::lock_guard lock(victim.mutex);
+        if (victim.begin == victim.end)
+          continue;
+        end = victim.end;
+        begin = victim.begin + (victim.end - victim.begin) / 2;
+        victim.end = begin;
+      }
+      std::lock_guard lock(ranges[worker].mutex);
+      if (cancelled)
+        return false;
+      ranges[worker].begin = begin;
+      ranges[worker].end = end;
+      return true;
+    }
+    return false;
+  }
+};
+
+} // namespace diffurch
@@ -2,6 +2,8 @@
 
 #include <array>
 #include <functional>
+#include <type_traits>
+#include <utility>
 #include <math.h>
 
 namespace diffurch {
@@ -60,6 +62,29 @@ std::array<T, N> operator*(T lhs, const std::array<T, N> &rhs) {
   return result;
 }
 
+/**
+ * @brief Products of an array of non-double elements (e.g. Lanes) and double.
+ */
+template <typename T, size_t N>
+  requires(!std::is_same_v<T, double>)
+std::array<T, N> operator*(const std::array<T, N> &lhs, double rhs) {
+  std::array<T, N> result;
+  for (size_t i = 0; i < N; ++i) {
+    result[i] = lhs[i] * rhs;
+  }
+  return result;
+}
+
+template <typename T, size_t N>
+  requires(!std::is_same_v<T, double>)
+std::array<T, N> operator*(double lhs, const std::array<T, N> &rhs) {
+  std::array<T, N> result;
+  for (size_t i = 0; i < N; ++i) {
+    result[i] = lhs * rhs[i];
+  }
+  return result;
+}
+
 /**
  * @brief Divide an array by a scalar.
  */
@@ -75,7 +100,7 @@ std::array<T, N> operator/(const std::array<T, N> &lhs, T rhs) {
  */
 template <typename T, size_t N>
 T operator*(const std::array<T, N> &lhs, const std::array<T, N> &rhs) {
-  T result;
+  T result{};
   for (size_t i = 0; i < N; ++i) {
     result += lhs[i] * rhs[i];
   }
@@ -92,6 +117,26 @@ dot(const ContainerL &lhs, const ContainerR &rhs, size_t size) {
   return result;
 }
 
+// Dot product of the first size elements of the constexpr array coefs (e.g.
+// a row of Butcher tableau) with rhs, unrolled at compile time. The terms with
+// zero coefficients are skipped, and the coefficients become immediate
+// values. For finite rhs, the result is the same as for dot(coefs, rhs, size).
+template <const auto &coefs, size_t size, typename ContainerR>
+auto dot(const ContainerR &rhs) {
+  std::remove_cvref_t<decltype(rhs[0])> result{};
+  [&]<size_t... j>(std::index_sequence<j...>) {
+    (
+        [&] {
+          if constexpr (coefs[j] == 1.)
+            result = result + rhs[j];
+          else if constexpr (coefs[j] != 0.)
+            result = result + coefs[j] * rhs[j];
+        }(),
+        ...);
+  }(std::make_index_sequence<size>{});
+  return result;
+}
+
 template <typename T, size_t N, size_t M>
 std::array<T, N + M> concatenate(const std::array<T, N> &arr1,
                                  const std::array<T, M> &arr2) {
@@ -0,0 +1,110 @@
+#include <iostream>
+
+#include "../../diffurch.hpp"
+#include "../../src/rk_tables/dp54.hpp"
+#include <tuple>
+
+using namespace std;
+using namespace diffurch;
+using namespace diffurch::variables_xyz_t;
+
+int error_count = 0;
+
+#define ASSERT(condition)                                                      \
+  if (!(condition)) {                                                          \
+    cout << "Assertion failed at " << __FILE__ << ":" << __LINE__ << endl;     \
+    error_count++;                                                             \
+  }
+
+// Lorenz system with parameters and initial conditions of type T, which is
+// double for a single trajectory, or Lanes for several
+template <typename T> struct Lorenz : Solver<Lorenz<T>> {
+  T rho;
+  T x0;
+  Lorenz(const T &rho_, const T &x0_) : rho(rho_), x0(x0_) {}
+  auto get_rhs() {
+    return 10. * (y - x) | x * (rho - z) - y | x * y - 8. / 3. * z;
+  }
+  auto get_ic() { return Constant(x0) | 2. | 20. + 0. * t; }
+};
+
+template <typename T> struct Pendulum : Solver<Pendulum<T>> {
+  T amplitude;
+  Pendulum(const T &amplitude_) : amplitude(amplitude_) {}
+  auto get_rhs() { return y | -sin(x) - 0.1 * pow(y, 3); }
+  auto get_ic() { return Constant(amplitude) | 0.; }
+};
+
+// equal up to rounding: with -march=native, the lanes and the single
+// trajectories can be compiled with different fused multiply-add contractions
+bool close(double a, double b) { return abs(a - b) <= 1e-10 * (1. + abs(b)); }
+
+int main() {
+  { // arithmetic of lanes
+    Lanes<4> a(array<double, 4>{1., 2., 3., 4.});
+    Lanes<4> b = 2.;
+    ASSERT((a + b)[3] == 6.);
+    ASSERT((a * b - 1.)[1] == 3.);
+    ASSERT((1. / a)[1] == 0.5);
+    ASSERT((-a)[0] == -1.);
+    ASSERT(pow(a, 2)[2] == 9.);
+    ASSERT(sin(a)[3] == std::sin(4.));
+    ASSERT(a == a && !(a == b));
+
+    // the width is not a power of two
+    Lanes<3> c(array<double, 3>{1., 2., 3.});
+    ASSERT((c * c + 1.)[2] == 10.);
+    static_assert(alignof(Lanes<3>) == 32);
+  }
+
+  { // the lanes of the batch are the same as separate solutions
+    constexpr size_t W = 4;
+    Lanes<W> rho(array<double, W>{0.5, 10., 28., 99.96});
+    Lanes<W> x0(array<double, W>{1., -1., 0.5, 1.});
+    Lorenz<Lanes<W>> batch(rho, x0);
+
+    auto saved =
+        batch_solution(batch, 0., 5., ConstantStepsize(0.01), t | x | y | z);
+    auto final_state = batch_solution(batch, 0., 5., ConstantStepsize(0.01));
+    ASSERT(saved.back() == (array<Lanes<W>, 4>{t(5.), final_state[0],
+                                               final_state[1],
+                                               final_state[2]}));
+
+    for (size_t i = 0; i < W; i++) {
+      auto [t_, x_, y_, z_] = Lorenz<double>(rho[i], x0[i]).solution(
+          0., 5., ConstantStepsize(0.01),
+          make_tuple(StepEvent(t | x | y | z)));
+      ASSERT(saved.size() == t_.size());
+      bool same = true;
+      for (size_t k = 0; k < saved.size(); k++) {
+        auto s = lane(saved[k], i);
+        same = same && s[0] == t_[k] && close(s[1], x_[k]) &&
+               close(s[2], y_[k]) && close(s[3], z_[k]);
+      }
+      ASSERT(same);
+    }
+  }
+
+  { // functions and FSAL method
+    constexpr size_t W = 8;
+    Lanes<W> amplitudes;
+    for (size_t i = 0; i < W; i++)
+      amplitudes[i] = 0.1 + 0.4 * i;
+    Pendulum<Lanes<W>> batch(amplitudes);
+    auto final_state =
+        batch_solution<dp54>(batch, 0., 10., ConstantStepsize(0.01));
+    for (size_t i = 0; i < W; i++) {
+      auto [x_, y_] = Pendulum<double>(amplitudes[i])
+                          .solution<dp54>(0., 10., ConstantStepsize(0.01),
+                                          make_tuple(StopEvent(x | y)));
+      ASSERT(close(lane(final_state, i)[0], x_[0]));
+      ASSERT(close(lane(final_state, i)[1], y_[0]));
+    }
+  }
+
+  if (error_count == 0) {
+    cout << "All tests finished succesfully" << endl;
+  } else {
+    cout << error_count << " assertions failed." << endl;
+  }
+}
@@ -0,0 +1,154 @@
+#include <iostream>
+
+#include "../../diffurch.hpp"
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+using namespace diffurch;
+using namespace diffurch::variables_xyz_t;
+
+int error_count = 0;
+
+#define ASSERT(condition)                                                      \
+  if (!(condition)) {                                                          \
+    cout << "Assertion failed at " << __FILE__ << ":" << __LINE__ << endl;     \
+    error_count++;                                                             \
+  }
+
+struct Bomb : Solver<Bomb> {
+  double epsilon;
+  double amp;
+  Bomb(double epsilon_, double amp_) : epsilon(epsilon_), amp(amp_) {}
+  auto get_rhs() {
+    return Vector(-x + (1 + epsilon) * D(x)(t - 1.) -
+                  0.1 * pow(D(x)(t - 1.), 3));
+  }
+  auto get_ic() { return Vector(amp * sin(2 * M_PI * t)); }
+};
+
+int main() {
+  { // each index is processed exactly once, also with unbalanced tasks
+    for (size_t num_threads : {1, 2, 3, 8}) {
+      ThreadPool pool(num_threads);
+      ASSERT(pool.size() == num_threads);
+      for (size_t n : {0, 1, 5, 100, 1000}) {
+        vector<atomic<int>> counts(n);
+        pool.for_each_index(n, [&](size_t i) {
+          if (i < 3) // the first range is much longer to process
+            this_thread::sleep_for(chrono::milliseconds(10));
+          counts[i]++;
+        });
+        bool all_once = true;
+        for (auto &count : counts)
+          all_once = all_once && count == 1;
+        ASSERT(all_once);
+      }
+    }
+  }
+
+  { // the exception of a call is rethrown, after the other calls finished,
+    // and the pool can be used again
+    for (size_t num_threads : {1, 4}) {
+      ThreadPool pool(num_threads);
+      atomic<int> running = 0, calls = 0;
+      bool thrown = false;
+      try {
+        pool.for_each_index(1000, [&](size_t i) {
+          running++;
+          this_thread::sleep_for(chrono::microseconds(100));
+          calls++;
+          running--;
+          if (i % 100 == 0)
+            throw i;
+        });
+      } catch (size_t) {
+        thrown = true;
+      }
+      ASSERT(thrown && running == 0 && calls < 1000);
+      calls = 0;
+      pool.for_each_index(100, [&](size_t) { calls++; });
+      ASSERT(calls == 100);
+    }
+  }
+
+  { // no calls are started after the exception, also by the workers, that
+    // steal ranges at that time
+    for (size_t num_threads : {2, 8}) {
+      ThreadPool pool(num_threads);
+      atomic<bool> throwing = false;
+      atomic<int> started_after_throw = 0;
+      try {
+        pool.for_each_index(1000, [&](size_t i) {
+          if (throwing)
+            started_after_throw++;
+          // the range of the first worker is slower, so that the others
+          // steal from it and from each other
+          this_thread::sleep_for(chrono::microseconds(i < 125 ? 200 : 20));
+          if (i == 60) {
+            throwing = true;
+            throw i;
+          }
+        });
+      } catch (size_t) {
+      }
+      // only the calls, that were started before the exception reached the
+      // pool, one for each of the other workers at most
+      ASSERT(throwing && started_after_throw < int(num_threads));
+    }
+  }
+
+  { // parallel results are the same as serial ones
+    vector<double> rhos = {0.5, 10., 24., 28., 99.96, 160.};
+    vector<equation::Lorenz> equations;
+    for (double rho : rhos)
+      equations.push_back(equation::Lorenz(10., rho));
+    auto events = make_tuple(StepEvent(t | x | y | z));
+    auto controller = AdaptiveStepsize{.atol = 1e-9, .rtol = 1e-9};
+
+    ThreadPool pool(3);
+    auto results =
+        ensemble_solution(pool, equations, 0., 20., controller, events);
+    ASSERT(results.size() == rhos.size());
+    for (size_t i = 0; i < rhos.size(); i++) {
+      auto serial =
+          equation::Lorenz(10., rhos[i]).solution(0., 20., controller, events);
+      ASSERT(results[i] == serial);
+    }
+
+    // parameters given as tuples, and the pool of all hardware threads
+    auto tuples = make_equations<equation::Lorenz>(
+        vector{tuple(10., 28., 8. / 3.), tuple(10., 28., 8. / 3.)});
+    auto same = ensemble_solution(tuples, 0., 20., controller, events);
+    ASSERT(same[0] == same[1]);
+    ASSERT(same[0] == results[3]);
+
+    // single parameters
+    auto sigmas = make_equations<equation::Lorenz>(vector{10., 10.});
+    ASSERT(ensemble_solution(sigmas, 0., 20., controller, events)[1] ==
+           results[3]);
+  }
+
+  { // delay equations with history
+    vector<tuple<double, double>> parameters;
+    for (double amp : {0.05, 0.1, 0.17})
+      parameters.push_back({0.1, amp});
+    auto equations = make_equations<Bomb>(parameters);
+    auto events = make_tuple(StopEvent(x));
+    auto results = ensemble_solution(equations, 0., 50.,
+                                     ConstantStepsize(0.02), events);
+    for (size_t i = 0; i < parameters.size(); i++) {
+      auto serial = make_from_tuple<Bomb>(parameters[i])
+                        .solution(0., 50., ConstantStepsize(0.02), events);
+      ASSERT(results[i] == serial);
+    }
+  }
+
+  if (error_count == 0) {
+    cout << "All tests finished succesfully" << endl;
+  } else {
+    cout << error_count << " assertions failed." << endl;
+  }
+}
@@ -1,9 +1,11 @@
 #include <iostream>
 
+#include "../../src/equations/harmonic_oscillator.hpp"
 #include "../../src/events.hpp"
 #include "../../src/symbolic.hpp"
 #include "../../src/util/print.hpp"
 #include <cstddef>
+#include <limits>
 #include <tuple>
 
 using namespace std;
@@ -46,6 +48,15 @@ int main() {
         EventSaveInterface([](const auto &state) { return state.t_curr; });
     esi.save(state);
     ASSERT(esi.saved == make_tuple(vector<double>{42}));
+    // the lambda may evaluate the whole past of the state
+    ASSERT(esi.max_delay() == numeric_limits<double>::infinity());
+    ASSERT(EventSaveInterface(x(t - 2.)).max_delay() == 2.);
+    ASSERT(StopEvent(x).max_delay() == 0.);
+    auto reading = handler_reading(x(t - 3.), [](const auto &state) {
+      return state.t_curr;
+    });
+    ASSERT(reading(state) == 42);
+    ASSERT(StepEvent(nullptr, reading).max_delay() == 3.);
   }
 
   { // Saving testing
@@ -171,6 +182,18 @@ int main() {
     }
   }
 
+  { // events located at the same time are all called, also when a step event
+    // changes the state (and makes a zero step) before them
+    int first = 0, second = 0, steps = 0;
+    auto [t_] = equation::HarmonicOscillator().solution(
+        0.5, 10., ConstantStepsize(0.01),
+        make_tuple(Event(When(x == 0), t, [&] { first++; }),
+                   Event(When(x == 0), nullptr, [&] { second++; }),
+                   StepEvent(nullptr, [&](auto &) { steps++; })));
+    ASSERT(t_.size() == 3 && first == 3 && second == 3);
+    ASSERT(abs(t_[2] - 3. * M_PI) < 1e-10);
+  }
+
   if (error_count == 0) {
     cout << "All tests finished succesfully" << endl;
   } else {
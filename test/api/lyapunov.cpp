@@ -0,0 +1,114 @@
+#include <iostream>
+
+#include "../../diffurch.hpp"
+#include "../../src/rk_tables/dp54.hpp"
+#include <cmath>
+#include <type_traits>
+
+using namespace std;
+using namespace diffurch;
+using namespace diffurch::variables_xyz_t;
+
+int error_count = 0;
+
+#define ASSERT(condition)                                                      \
+  if (!(condition)) {                                                          \
+    cout << "Assertion failed at " << __FILE__ << ":" << __LINE__ << endl;     \
+    error_count++;                                                             \
+  }
+
+struct PointState {
+  double t_curr;
+  array<double, 4> x_curr;
+};
+
+int main() {
+  { // directional derivatives
+    PointState state{0.5, {1., 2., 3., 4.}};
+    // the direction is (z, w) = (3, 4) for the point (x, y) = (1, 2)
+    auto f = x * x * y + sin(t) * y;
+    ASSERT(abs(partial<Direction<2>>(f)(state) -
+               (2. * 2. * 3. + (1. + sin(0.5)) * 4.)) < 1e-14);
+    ASSERT((is_same_v<decltype(partial<Direction<2>>(x)), Variable<2>>));
+    ASSERT((is_same_v<decltype(partial<Direction<2>>(D(x))), Variable<2, 1>>));
+    // the delayed variables are linearized too
+    ASSERT(partial<Direction<2>>(x(t - 1.)).max_delay() == 1.);
+    // the tangent vector jumps at the switch of dsign
+    auto relay = partial<Direction<1>>(dsign(x));
+    ASSERT(relay(state) == 0.);
+    ASSERT(relay.weight(state) == 2. * 2.);
+  }
+
+  { // the norm of the tangent vectors
+    ASSERT(norm(Vec<3>{3., 4., 0.}) == 5.);
+    ASSERT((Vec<2>{1., 2.} * Vec<2>{3., 4.} == 11.));
+  }
+
+  { // the transforming set handler (as the orthonormalization) does not make
+    // the zero steps, and the last stage is still reused by FSAL methods
+    Variational<equation::Lorenz, 1> variational(equation::Lorenz{});
+    auto halve_tangent = handler_reading(Variable<>(), [](auto &state) {
+      state.transform([](auto x) {
+        for (size_t j = 3; j < 6; j++)
+          x[j] /= 2.;
+        return x;
+      });
+    });
+    auto solve = [&](auto set_handler) {
+      return variational.solution<dp54>(
+          0., 1., ConstantStepsize(0.01),
+          make_tuple(StepEvent(nullptr, set_handler),
+                     StopEvent(Variable<3>() | Variable<4>() | Variable<5>())),
+          CollectStatistics());
+    };
+    auto [v0, v1, v2, statistics] = solve(transforming_handler(halve_tangent));
+    auto [w0, w1, w2, zero_step_statistics] = solve(halve_tangent);
+    ASSERT(statistics.rhs_calls == (dp54::s - 1) * statistics.accepted_steps + 1);
+    ASSERT(zero_step_statistics.rhs_calls ==
+           dp54::s * zero_step_statistics.accepted_steps);
+    ASSERT(abs(v0[0] / w0[0] - 1.) < 1e-10 && abs(v1[0] / w1[0] - 1.) < 1e-10 &&
+           abs(v2[0] / w2[0] - 1.) < 1e-10);
+  }
+
+  { // linear equation
+    auto exponents =
+        lyapunov_exponents<1>(equation::LinearODE1(-2., 1.), 0., 10.);
+    ASSERT(abs(exponents[0] + 2.) < 1e-8);
+  }
+
+  { // Lorenz system, the sum of exponents is the divergence -(10 + 1 + 8/3)
+    auto [l1, l2, l3] = lyapunov_exponents<3>(equation::Lorenz(), 0., 100.);
+    ASSERT(abs(l1 + l2 + l3 + 41. / 3.) < 1e-8);
+    ASSERT(0.8 < l1 && l1 < 1.);
+    ASSERT(abs(l2) < 0.05);
+  }
+
+  { // relay system with periodic solutions, where the tangent vectors jump at
+    // the switches, and the volume is preserved
+    auto [l1, l2] = lyapunov_exponents<2>(equation::Relay2(), 0.5, 100.5,
+                                          ConstantStepsize(0.05));
+    ASSERT(abs(l1) < 0.05);
+    ASSERT(abs(l1 + l2) < 1e-3);
+  }
+
+  { // relay delay equation with stable periodic solution
+    auto [l1] = lyapunov_exponents<1>(equation::RelayDDE1(-1., 0., 1.), 0.,
+                                      100., ConstantStepsize(0.05));
+    ASSERT(abs(l1) < 1e-8);
+    auto [l1_decay] = lyapunov_exponents<1>(
+        equation::RelayDDE1(-1., -0.3, 1.), 0., 100., ConstantStepsize(0.05));
+    ASSERT(abs(l1_decay) < 0.02);
+  }
+
+  { // linear delay equation with solution exp(t)
+    auto [l1] = lyapunov_exponents<1>(equation::LinearDDE1Exp(0.5, 1., 1.), 0.,
+                                      50., ConstantStepsize(0.05));
+    ASSERT(abs(l1 - 1.) < 0.01);
+  }
+
+  if (error_count == 0) {
+    cout << "All tests finished succesfully" << endl;
+  } else {
+    cout << error_count << " assertions failed." << endl;
+  }
+}
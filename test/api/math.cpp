@@ -1,3 +1,4 @@
+#include "../../src/util/find_root.hpp"
 #include "../../src/util/math.hpp"
 #include "../../src/util/postprocessing.hpp"
 #include "../../src/util/print.hpp"
@@ -51,6 +52,28 @@ int main() {
     ASSERT(clip(6., -2., 4.) == 4.);
   }
 
+  { // root finding methods return the end of the bracket at the side of r
+    auto f = [](double t) { return cos(t) - 0.3; };
+    auto df = [](double t) { return -sin(t); };
+    double root = acos(0.3);
+    auto check = [&](double located, double, double r) {
+      ASSERT(abs(located - root) < 1e-14);
+      ASSERT((f(located) > 0) == (f(r) > 0) || f(located) == 0);
+    };
+    for (auto [l, r] : {pair{1., 1.5}, pair{1.5, 1.}, pair{0., root + 0.1}}) {
+      check(Bisection()(f, l, r), l, r);
+      check(Illinois()(f, l, r), l, r);
+      check(Brent()(f, l, r), l, r);
+      check(Newton()(f, df, l, r), l, r);
+    }
+    // no sign change
+    ASSERT(Brent()(f, 0., 0.5) == 0.5);
+    ASSERT(Illinois()(f, 0.5, 0.) == 0.);
+    // tolerance
+    ASSERT(abs(Brent(1e-6)(f, 1., 1.5) - root) < 1e-6);
+    ASSERT(abs(Illinois(1e-6)(f, 1., 1.5) - root) < 1e-6);
+  }
+
   if (error_count == 0) {
     cout << "All tests finished succesfully" << endl;
   } else {
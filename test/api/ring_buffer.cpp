@@ -0,0 +1,57 @@
+
+#include "../../src/util/ring_buffer.hpp"
+#include <iostream>
+
+int error_count = 0;
+#define ASSERT(condition)                                                      \
+  if (!(condition)) {                                                          \
+    cout << "Assertion failed at " << __FILE__ << ":" << __LINE__ << endl;     \
+    error_count++;                                                             \
+  }
+
+using namespace std;
+using namespace diffurch;
+
+int main() {
+  {
+    RingBuffer<double> b{1, 2, 3};
+    ASSERT(b.size() == 3);
+    ASSERT(b.front() == 1 && b.back() == 3);
+    b.pop_front();
+    ASSERT(b.size() == 2);
+    ASSERT(b[0] == 2 && b[1] == 3);
+  }
+  { // storage is reused when elements are popped
+    RingBuffer<int> b;
+    for (int i = 0; i < 1000; i++) {
+      b.push_back(i);
+      if (b.size() > 10)
+        b.pop_front();
+    }
+    ASSERT(b.size() == 10);
+    ASSERT(b.capacity() == 16);
+    ASSERT(b.front() == 990 && b.back() == 999);
+    for (size_t i = 0; i < b.size(); i++) {
+      ASSERT(b[i] == 990 + int(i));
+    }
+  }
+  { // order is preserved when the storage grows
+    RingBuffer<int> b;
+    for (int i = 0; i < 10; i++)
+      b.push_back(i);
+    for (int i = 0; i < 5; i++)
+      b.pop_front();
+    for (int i = 10; i < 40; i++)
+      b.push_back(i);
+    ASSERT(b.size() == 35);
+    for (size_t i = 0; i < b.size(); i++) {
+      ASSERT(b[i] == 5 + int(i));
+    }
+  }
+
+  if (error_count == 0) {
+    cout << "All tests finished succesfully" << endl;
+  } else {
+    cout << error_count << " assertions failed." << endl;
+  }
+}
@@ -0,0 +1,136 @@
+#include <iostream>
+
+#include "../../diffurch.hpp"
+#include <array>
+#include <cmath>
+#include <tuple>
+
+using namespace std;
+using namespace diffurch;
+using namespace diffurch::variables_xyz_t;
+
+int error_count = 0;
+
+#define ASSERT(condition)                                                      \
+  if (!(condition)) {                                                          \
+    cout << "Assertion failed at " << __FILE__ << ":" << __LINE__ << endl;     \
+    error_count++;                                                             \
+  }
+
+struct PointState {
+  double t_curr;
+  array<double, 3> x_curr;
+};
+
+int main() {
+  { // LU decomposition with pivoting
+    Mat<3> A{{{0., 2., 1.}, {1., 1., 1.}, {4., -1., 3.}}};
+    Mat<3> LU = A;
+    array<size_t, 3> pivots;
+    ASSERT(lu_decompose(LU, pivots));
+    Vec<3> x = lu_solve(LU, pivots, Vec<3>{3., 3., 6.});
+    ASSERT(abs(x[0] - 1.) < 1e-14 && abs(x[1] - 1.) < 1e-14 &&
+           abs(x[2] - 1.) < 1e-14);
+
+    Mat<3> singular{{{1., 2., 3.}, {2., 4., 6.}, {0., 1., 1.}}};
+    ASSERT(!lu_decompose(singular, pivots));
+  }
+
+  { // symbolic Jacobian and time derivative
+    auto rhs = 10. * (y - x) | x * (28. - z) - y | x * y - 8. / 3. * z;
+    PointState state{0.5, {1., 2., 3.}};
+    Mat<3> J = jacobian(rhs)(state);
+    ASSERT((J == Mat<3>{{{-10., 10., 0.}, {25., -1., -1.}, {2., 1., -8. / 3.}}}));
+    ASSERT((partial<TimeVariable>(rhs)(state) == Vec<3>{0., 0., 0.}));
+
+    auto f = sin(t) * pow(x, 3) + atan2(y, x) + exp(z) / y;
+    ASSERT(abs(partial<Variable<0>>(f)(state) -
+               (3. * sin(0.5) - 2. / 5.)) < 1e-14);
+    ASSERT(abs(partial<Variable<1>>(f)(state) - (1. / 5. - exp(3.) / 4.)) <
+           1e-14);
+    ASSERT(abs(partial<Variable<2>>(f)(state) - exp(3.) / 2.) < 1e-14);
+    ASSERT(abs(partial<TimeVariable>(f)(state) - cos(0.5)) < 1e-14);
+  }
+
+  { // stable for stiff equations with large steps, where explicit methods
+    // are not
+    equation::ProtheroRobinson equation(-1e6);
+    auto [x_rosenbrock] = equation.solution<rosenbrock23>(
+        0., 2., ConstantStepsize(0.01), make_tuple(StopEvent(equation.x)));
+    ASSERT(abs(x_rosenbrock[0] - sin(2.)) < 1e-4);
+    auto [x_explicit] = equation.solution(0., 2., ConstantStepsize(0.01),
+                                          make_tuple(StopEvent(equation.x)));
+    ASSERT(!(abs(x_explicit[0] - sin(2.)) < 1.));
+  }
+
+  { // second order, with the LU decomposition reused for the linear equation
+    double previous_error = 0.;
+    for (double h : {0.1, 0.05, 0.025}) {
+      auto [x_, statistics] =
+          equation::HarmonicOscillator().solution<rosenbrock23>(
+              0., 10., ConstantStepsize(h),
+              make_tuple(StopEvent(equation::HarmonicOscillator::x)),
+              CollectStatistics());
+      double error = abs(x_[0] - sin(10.));
+      if (previous_error != 0.)
+        ASSERT(abs(previous_error / error - 4.) < 0.2);
+      previous_error = error;
+      // the last step is shorter
+      ASSERT(statistics.lu_decompositions <= 2);
+      // the Jacobian is reevaluated every max_jacobian_age steps
+      ASSERT(statistics.jacobian_evaluations * 10 < statistics.accepted_steps);
+    }
+  }
+
+  { // adaptive stepsize, the Jacobian and the LU decomposition are kept over
+    // the steps, for which the stepsize is not changed much
+    auto [x_, y_, z_, statistics] = equation::Robertson().solution<rosenbrock23>(
+        0., 40., AdaptiveStepsize{.atol = 1e-8, .rtol = 1e-8},
+        make_tuple(StopEvent(x | y | z)), CollectStatistics());
+    ASSERT(abs(x_[0] - 0.7158271) < 1e-6);
+    ASSERT(abs(y_[0] - 9.185535e-6) < 1e-10);
+    ASSERT(abs(z_[0] - 0.2841637) < 1e-6);
+    size_t steps = statistics.accepted_steps + statistics.rejected_steps;
+    ASSERT(statistics.jacobian_evaluations <= statistics.lu_decompositions);
+    ASSERT(statistics.lu_decompositions < 0.6 * steps);
+    // the last stage is reused as the first stage of the next step
+    ASSERT(statistics.rhs_calls ==
+           2 * (statistics.accepted_steps + statistics.rejected_steps) + 1);
+  }
+
+  { // the step, for which I - h gamma J is singular, is rejected
+    double h = 0.02;
+    double lambda = 1. / (h * rosenbrock23::gamma);
+    ASSERT(1. - h * rosenbrock23::gamma * lambda == 0.);
+    equation::LinearODE1 equation(lambda, 1.);
+    auto [t_rejected, x_, statistics] = equation.solution<rosenbrock23>(
+        0., 0.05,
+        AdaptiveStepsize{.atol = 1e-8, .rtol = 1e-8, .initial_stepsize = h},
+        make_tuple(StopEvent(equation.x), RejectEvent(equation.t)),
+        CollectStatistics());
+    ASSERT(statistics.rejected_steps > 0);
+    // the reject events are called for it, as for the steps rejected by error
+    ASSERT(t_rejected.size() == statistics.rejected_steps);
+    ASSERT(t_rejected[0] == 0.);
+    ASSERT(abs(x_[0] / exp(lambda * 0.05) - 1.) < 1e-5);
+  }
+
+  { // events and dense output of discontinuous equation
+    equation::Relay2 equation;
+    auto [t_, x_] = equation.solution<rosenbrock23>(
+        -0.001, 20., AdaptiveStepsize{.atol = 1e-6, .rtol = 1e-6},
+        make_tuple(Event(When(equation.Dx == 0.), equation.t | equation.x)));
+    ASSERT(t_.size() >= 5);
+    bool correct = true;
+    for (size_t i = 0; i < t_.size(); i++)
+      correct = correct && abs(remainder(t_[i] - 2., 4.)) < 1e-8 &&
+                abs(abs(x_[i]) - 2.) < 1e-8;
+    ASSERT(correct && abs(t_[4] - 18.) < 1e-8);
+  }
+
+  if (error_count == 0) {
+    cout << "All tests finished succesfully" << endl;
+  } else {
+    cout << error_count << " assertions failed." << endl;
+  }
+}
@@ -0,0 +1,241 @@
+#include <iostream>
+
+#include "../../diffurch.hpp"
+#include "../../src/runtime/jit.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <numbers>
+#include <string>
+#include <tuple>
+
+using namespace std;
+using namespace diffurch;
+
+int error_count = 0;
+
+#define ASSERT(condition)                                                      \
+  if (!(condition)) {                                                          \
+    cout << "Assertion failed at " << __FILE__ << ":" << __LINE__ << endl;     \
+    error_count++;                                                             \
+  }
+
+struct PointState {
+  double t_curr;
+  array<double, 2> x_curr;
+};
+
+int main() {
+  { // evaluation
+    PointState state{0.5, {2., 3.}};
+    auto f = RuntimeExpression<Vec<3>>(parse_expressions(
+        {"x * y + sin(t)", "-x^2 / (1 + a)", "pow(y, 2) - 2"}, {"x", "y"},
+        {{"a", 3.}}));
+    ASSERT((f(state) == Vec<3>{2. * 3. + sin(0.5), -4. / 4., 9. - 2.}));
+    ASSERT(f.set_parameter("a", 1.));
+    ASSERT(f(state)[1] == -2.);
+    ASSERT(!f.set_parameter("b", 1.));
+
+    // the constant operations are evaluated, and the identical instructions
+    // are built once
+    ASSERT(parse_expressions({"2^3 * pi - 1"}).code.size() == 0);
+    ASSERT(parse_expressions({"sin(x) + sin(x)"}, {"x"}).code.size() == 2);
+    ASSERT(parse_expressions({"a * x"}, {"x"}, {{"a", 1.}}).code.size() == 1);
+
+    auto g = RuntimeExpression(parse_expressions({"exp(-t)"}));
+    ASSERT(g(1.) == exp(-1.));
+
+    // nan and -0 are the constants different from the others
+    auto value = [&state](const char *expression) {
+      return RuntimeExpression(parse_expressions({expression}, {"x", "y"}))(
+          state);
+    };
+    ASSERT(isnan(value("x + sqrt(0 - 1)")));
+    ASSERT(isnan(value("x + 0 / 0")));
+    ASSERT(isnan(value("x * 5 + (0 / 0)")));
+    ASSERT(value("1 / (-0)") == -numeric_limits<double>::infinity());
+    ASSERT(value("1 / 0") == numeric_limits<double>::infinity());
+  }
+
+  { // errors
+    ASSERT(!parse_expressions({"x +"}, {"x"}).error.empty());
+    ASSERT(!parse_expressions({"foo(x)"}, {"x"}).error.empty());
+    ASSERT(!parse_expressions({"x'"}, {"x"}).error.empty());
+    ASSERT(!parse_expressions({"(x"}, {"x"}).error.empty());
+    ASSERT(!parse_expressions({"x y"}, {"x", "y"}).error.empty());
+    ASSERT(!parse_expressions({"pow(x)"}, {"x"}).error.empty());
+    ASSERT(parse_expressions({"x'(t - 1) + y(t - 2)"}, {"x", "y"})
+               .error.empty());
+    // the initial condition depends only on t
+    RuntimeEquation<1> equation({"x"}, {"-x"}, {"x"});
+    ASSERT(!equation.error.empty());
+  }
+
+  { // the same solution as the equation with the symbolic right hand side
+    RuntimeEquation<3> lorenz(
+        {"x", "y", "z"},
+        {"sigma * (y - x)", "x * (rho - z) - y", "x * y - beta * z"},
+        {"1.1", "1.2", "20"},
+        {{"sigma", 10.}, {"rho", 28.}, {"beta", 8. / 3.}});
+    ASSERT(lorenz.error.empty());
+    auto stop = make_tuple(StopEvent(Variables<3>()));
+    auto [x, y, z] = lorenz.solution(0., 10., ConstantStepsize(0.01), stop);
+    auto [x_, y_, z_] =
+        equation::Lorenz().solution(0., 10., ConstantStepsize(0.01), stop);
+    ASSERT(abs(x[0] - x_[0]) + abs(y[0] - y_[0]) + abs(z[0] - z_[0]) < 1e-8);
+
+    // the parameters are changed without parsing
+    ASSERT(lorenz.set_parameter("rho", 10.));
+    auto [x_rho] = lorenz.solution(0., 10., ConstantStepsize(0.01),
+                                   make_tuple(StopEvent(Variable<0>())));
+    auto [x_rho_] = equation::Lorenz(10., 10.).solution(
+        0., 10., ConstantStepsize(0.01), make_tuple(StopEvent(Variable<0>())));
+    ASSERT(abs(x_rho[0] - x_rho_[0]) < 1e-8);
+  }
+
+  { // delay equation with solution exp(t)
+    RuntimeEquation<1> equation(
+        {"x"}, {"a * x + b * x(t - tau)"}, {"exp(t)"},
+        {{"a", 0.5}, {"b", 0.5 * exp(1.)}, {"tau", 1.}});
+    ASSERT(equation.get_rhs().max_delay() == 1.);
+    // the delay is kept once for the identical delayed variables
+    Bytecode repeated = parse_expressions({"x(t - 1) + x(t - 1) * x(t - 2)"},
+                                          {"x"});
+    ASSERT(repeated.delays.size() == 2);
+    auto [x] = equation.solution(0., 5., ConstantStepsize(0.01),
+                                 make_tuple(StopEvent(Variable<0>())));
+    ASSERT(abs(x[0] - exp(5.)) < 1e-8 * exp(5.));
+
+    // state dependent delay
+    RuntimeEquation<1> state_dependent({"x"}, {"-x(t - 1 - x^2)"}, {"1"});
+    ASSERT(state_dependent.get_rhs().max_delay() ==
+           numeric_limits<double>::infinity());
+  }
+
+  { // neutral equation x'(t) = x'(t - 1), with x(t) = sin(t) for t <= 0
+    RuntimeEquation<1> equation({"x"}, {"x'(t - 1)"}, {"sin(t)"});
+    auto [x] = equation.solution(0., 1., ConstantStepsize(0.01),
+                                 make_tuple(StopEvent(Variable<0>())));
+    ASSERT(abs(x[0] - sin(1.)) < 1e-6);
+  }
+
+  { // events with the runtime expressions
+    RuntimeEquation<2> oscillator({"x", "y"}, {"y", "-x"},
+                                  {"cos(t)", "-sin(t)"});
+    auto x = RuntimeExpression(parse_expressions({"x"}, {"x", "y"}));
+    auto [t_zero] =
+        oscillator.solution(0., 10., ConstantStepsize(0.01),
+                            make_tuple(Event(When(x == 0.), TimeVariable())));
+    ASSERT(t_zero.size() == 3);
+    for (size_t i = 0; i < t_zero.size(); i++)
+      ASSERT(abs(t_zero[i] - numbers::pi * (i + 0.5)) < 1e-10);
+
+    // the expression of time only
+    auto f = RuntimeExpression(parse_expressions({"t - 5"}, {"x", "y"}));
+    auto [t_five] =
+        oscillator.solution(0., 10., ConstantStepsize(0.01),
+                            make_tuple(Event(When(f == 0.), TimeVariable())));
+    ASSERT(t_five.size() == 1 && abs(t_five[0] - 5.) < 1e-12);
+  }
+
+  { // the expressions compiled to native code
+    // a new directory for each run, so that the runs do not share the cache
+    JitOptions options;
+    string cache_template =
+        (filesystem::temp_directory_path() / "diffurch_test_runtime_jit.XXXXXX")
+            .string();
+    ASSERT(mkdtemp(cache_template.data()) != nullptr);
+    options.cache_directory = cache_template;
+
+    PointState state{0.5, {2., 3.}};
+    auto bytecode = parse_expressions(
+        {"x * y + sin(t)", "-x^2 / (1 + a)", "atan2(y, -1) - sign(x) / 0"},
+        {"x", "y"}, {{"a", 3.}});
+    auto f = RuntimeExpression<Vec<3>>(bytecode);
+    auto interpreted = f(state);
+    ASSERT(compile(f, options));
+    ASSERT(!f.compiled->cached);
+    ASSERT(f(state) == interpreted);
+    // the cache is accessible by the user only
+    ASSERT(filesystem::status(options.cache_directory).permissions() ==
+           filesystem::perms::owner_all);
+    ASSERT(f.set_parameter("a", 1.));
+    ASSERT(f(state)[1] == -2.);
+
+    // the library is loaded from the cache
+    auto g = RuntimeExpression<Vec<3>>(bytecode);
+    ASSERT(compile(g, options));
+    ASSERT(g.compiled->cached);
+    ASSERT(g(state) == interpreted);
+
+    // the powers, that the compiler replaces with the arithmetic for the
+    // constant exponents (x^2 by x * x), have the values of the interpreter,
+    // also for the exponents in parameters
+    auto powers = RuntimeExpression<Vec<3>>(parse_expressions(
+        {"x^2", "y^-1", "x^n"}, {"x", "y"}, {{"n", 2.}}));
+    auto compiled_powers = powers;
+    ASSERT(compile(compiled_powers, options));
+    bool same_powers = true;
+    for (int i = 0; i < 10000; i++) {
+      PointState point{0., {5. * sin(i), 7. * cos(i)}};
+      same_powers = same_powers && compiled_powers(point) == powers(point);
+    }
+    ASSERT(same_powers);
+
+    // the delayed variables, with the same solution as of the interpreter
+    RuntimeEquation<1> equation({"x"}, {"-x(t - 1) + 0.1 * x'(t - 2)"},
+                                {"cos(t)"});
+    auto stop = make_tuple(StopEvent(Variable<0>()));
+    auto [x] = equation.solution(0., 10., ConstantStepsize(0.01), stop);
+    ASSERT(compile(equation, options));
+    auto [x_compiled] =
+        equation.solution(0., 10., ConstantStepsize(0.01), stop);
+    ASSERT(x_compiled[0] == x[0]);
+
+    // the library is compiled again, when bytecode.hpp changes
+    JitOptions copied = options;
+    copied.include_directory = options.cache_directory / "include";
+    filesystem::create_directory(copied.include_directory);
+    filesystem::copy_file(options.include_directory / "bytecode.hpp",
+                          copied.include_directory / "bytecode.hpp");
+    auto first_header = RuntimeExpression<Vec<3>>(bytecode);
+    ASSERT(compile(first_header, copied));
+    auto same_header = RuntimeExpression<Vec<3>>(bytecode);
+    ASSERT(compile(same_header, copied));
+    ASSERT(same_header.compiled->cached);
+    ofstream(copied.include_directory / "bytecode.hpp", ios::app) << "\n";
+    auto changed_header = RuntimeExpression<Vec<3>>(bytecode);
+    ASSERT(compile(changed_header, copied));
+    ASSERT(!changed_header.compiled->cached);
+
+    // the library is not loaded from the directory writable by others
+    filesystem::permissions(options.cache_directory,
+                            filesystem::perms::others_write,
+                            filesystem::perm_options::add);
+    auto shared = RuntimeExpression<Vec<3>>(bytecode);
+    ASSERT(!compile(shared, options));
+    ASSERT(!shared.compiled->error.empty());
+    ASSERT(shared(state) == interpreted);
+    filesystem::permissions(options.cache_directory,
+                            filesystem::perms::others_write,
+                            filesystem::perm_options::remove);
+
+    // the interpreter is used, if the bytecode is not compiled
+    options.compiler = "/nonexistent/compiler";
+    auto h = RuntimeExpression<Vec<3>>(bytecode);
+    ASSERT(!compile(h, options));
+    ASSERT(!h.compiled->error.empty());
+    ASSERT(h(state) == interpreted);
+
+    filesystem::remove_all(options.cache_directory);
+  }
+
+  if (error_count == 0) {
+    cout << "All tests finished succesfully" << endl;
+  } else {
+    cout << error_count << " assertions failed." << endl;
+  }
+  return 0;
+}
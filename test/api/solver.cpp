@@ -0,0 +1,210 @@
+#include <iostream>
+
+#include "../../diffurch.hpp"
+#include "../../src/rk_tables/dp54.hpp"
+#include <cmath>
+#include <tuple>
+
+using namespace std;
+using namespace diffurch;
+using namespace diffurch::variables_xyz_t;
+
+int error_count = 0;
+
+#define ASSERT(condition)                                                      \
+  if (!(condition)) {                                                          \
+    cout << "Assertion failed at " << __FILE__ << ":" << __LINE__ << endl;     \
+    error_count++;                                                             \
+  }
+
+// dp54 without the declared FSAL property
+struct dp54_no_fsal : dp54 {
+  constexpr static bool fsal = false;
+};
+
+// the Lorenz system from the initial state (1, 2, 20)
+auto lorenz() { return equation::Lorenz(10., 28., 8. / 3., {1., 2., 20.}); }
+
+int main() {
+  { // FSAL property of the tables
+    static_assert(is_fsal_v<dp54>);
+    static_assert(!is_fsal_v<dp54_no_fsal>);
+    static_assert(!is_fsal_v<rk98>);
+    static_assert(last_stage_is_step_end<dp54>());
+    static_assert(!last_stage_is_step_end<rk98>());
+  }
+
+  { // error weights are b - bb, computed at compile time
+    static_assert(error_weights_v<dp54>[0] == dp54::b[0] - dp54::bb[0]);
+    static_assert(error_weights_v<rk98>[6] == rk98::b[6] - rk98::bb[6]);
+
+    // the error estimate of the first step is h * sum((b - bb) * K) for the
+    // stages K of the step
+    size_t steps = 0;
+    double error_norm = 0., expected_norm = 0.;
+    lorenz().solution<dp54>(
+        0., 1., AdaptiveStepsize{.atol = 1e-6, .rtol = 1e-6},
+        make_tuple(StepEvent(nullptr, [&](const auto &state) {
+          if (steps++ != 1)
+            return;
+          double h = state.t_curr - state.t_prev;
+          error_norm = expected_norm = 0.;
+          for (size_t i = 0; i < 3; i++) {
+            double expected = 0.;
+            for (size_t j = 0; j < dp54::s; j++)
+              expected += (dp54::b[j] - dp54::bb[j]) * state.K_curr[j][i];
+            expected *= h;
+            error_norm += state.error_curr[i] * state.error_curr[i];
+            expected_norm += expected * expected;
+          }
+        })));
+    ASSERT(expected_norm > 0.);
+    ASSERT(abs(sqrt(error_norm) - sqrt(expected_norm)) <
+           1e-12 * sqrt(expected_norm));
+  }
+
+  { // the last stage of dp54 is reused as the first stage of the next step
+    // (the calls are counted by a save handler, since set handlers of call
+    // events disable the reuse)
+    auto solve = [](auto rk, auto controller) {
+      auto [ts, xs, ys, zs, t_call] = lorenz().solution<decltype(rk)>(
+          0., 10., controller,
+          make_tuple(StepEvent(t | x | y | z), CallEvent(t)));
+      return make_pair(make_tuple(ts, xs, ys, zs), t_call.size());
+    };
+    auto [sol_fsal, calls_fsal] = solve(dp54(), ConstantStepsize(0.01));
+    auto [sol_no_fsal, calls_no_fsal] =
+        solve(dp54_no_fsal(), ConstantStepsize(0.01));
+    size_t steps = get<0>(sol_fsal).size() - 1;
+    ASSERT(sol_fsal == sol_no_fsal);
+    ASSERT(calls_no_fsal == 7 * steps);
+    ASSERT(calls_fsal == 6 * steps + 1);
+
+    // with rejected steps
+    auto controller = AdaptiveStepsize{.atol = 1e-8, .rtol = 1e-8};
+    auto adaptive_fsal = solve(dp54(), controller);
+    auto adaptive_no_fsal = solve(dp54_no_fsal(), controller);
+    ASSERT(adaptive_fsal.first == adaptive_no_fsal.first);
+    ASSERT(adaptive_fsal.second < adaptive_no_fsal.second);
+  }
+
+  { // the last stage is not reused, if a call event can change the rhs
+    double k = 1.;
+    struct Harmonic : Solver<Harmonic> {
+      double *k;
+      Harmonic(double *k_) : k(k_) {}
+      auto get_rhs() {
+        return y |
+               state_function(x, [k = this->k](double v) { return -*k * v; });
+      }
+      auto get_ic() { return sin(t) | cos(t); }
+    };
+    auto solve = [&](auto rk) {
+      size_t calls = 0;
+      k = 1.;
+      // the coefficient alternates with each call of rhs, so a skipped call
+      // changes the trajectory
+      return Harmonic(&k).solution<decltype(rk)>(
+          0., 10., ConstantStepsize(0.01),
+          make_tuple(StepEvent(t | x | y), CallEvent(nullptr, [&]() {
+                       k = ++calls % 2 ? 1.5 : 1.;
+                     })));
+    };
+    ASSERT(solve(dp54()) == solve(dp54_no_fsal()));
+  }
+
+  { // the last stage, that evaluates the current step, is not reused: the
+    // delay 0.01 is shorter than the step, while the largest delay 1 is not,
+    // and the state dependent delay is not known
+    struct TwoDelays : Solver<TwoDelays> {
+      auto get_rhs() { return Vector(-x(t - 1.) - 0.5 * x(t - 0.01)); }
+      auto get_ic() { return Vector(1. + 0. * t); }
+    };
+    struct StateDependent : Solver<StateDependent> {
+      auto get_rhs() { return Vector(-x(t - 0.01 * (1. + x * x))); }
+      auto get_ic() { return Vector(1. + 0. * t); }
+    };
+    auto solve = [](auto equation, auto rk) {
+      return equation.template solution<decltype(rk)>(
+          0., 5., ConstantStepsize(0.1), make_tuple(StepEvent(t | x)));
+    };
+    ASSERT(solve(TwoDelays(), dp54()) == solve(TwoDelays(), dp54_no_fsal()));
+    ASSERT(solve(StateDependent(), dp54()) ==
+           solve(StateDependent(), dp54_no_fsal()));
+  }
+
+  { // the first stage is not reused after the state is changed by an event
+    struct Harmonic : Solver<Harmonic> {
+      auto get_rhs() { return y | -x; }
+      auto get_ic() { return sin(t) | cos(t); }
+    };
+    auto solve = [](auto rk) {
+      return Harmonic().solution<decltype(rk)>(
+          0., 10., ConstantStepsize(0.01),
+          make_tuple(Event(When(x == 0), t, y << 0.5 * y),
+                     StopEvent(t | x | y)));
+    };
+    auto sol_fsal = solve(dp54());
+    auto sol_no_fsal = solve(dp54_no_fsal());
+    ASSERT(sol_fsal == sol_no_fsal);
+    auto [t_event, t_stop, x_stop, y_stop] = sol_fsal;
+    // the event with setting is saved before and after the change of state
+    ASSERT(t_event.size() == 6);
+    // the amplitude is halved at each zero
+    ASSERT(abs(x_stop[0] - sin(10.) / 8.) < 1e-6);
+  }
+
+  { // statistics are the same as the counts by events, and do not change
+    // the solution
+    auto controller = AdaptiveStepsize{.atol = 1e-8, .rtol = 1e-8};
+    auto events = make_tuple(StepEvent(t), RejectEvent(t), CallEvent(t));
+    auto counted = lorenz().solution<dp54>(0., 10., controller, events);
+    auto [t_step, t_reject, t_call, statistics] =
+        lorenz().solution<dp54>(0., 10., controller, events,
+                                CollectStatistics());
+    ASSERT(counted == make_tuple(t_step, t_reject, t_call));
+    ASSERT(statistics.accepted_steps == t_step.size() - 1);
+    ASSERT(statistics.rejected_steps == t_reject.size());
+    ASSERT(statistics.rejected_steps > 0);
+    ASSERT(statistics.rhs_calls == t_call.size());
+    ASSERT(statistics.locate_calls == 0);
+    ASSERT(statistics.history_lookups == 0);
+
+    // event location
+    auto [t_event, event_statistics] = lorenz().solution(
+        0., 10., ConstantStepsize(0.01), make_tuple(Event(When(x == 0), t)),
+        CollectStatistics());
+    ASSERT(event_statistics.locate_calls == event_statistics.accepted_steps);
+    ASSERT(event_statistics.root_finder_evaluations > 2 * t_event.size());
+
+    // history lookups
+    struct Delayed : Solver<Delayed> {
+      auto get_rhs() { return Vector(-x(t - 1.) - 0.5 * x(t - 1.)); }
+      auto get_ic() { return Vector(1. + 0. * t); }
+    };
+    auto [history_statistics] =
+        Delayed().solution(0., 10., ConstantStepsize(0.1),
+                           make_tuple(), CollectStatistics());
+    ASSERT(history_statistics.rhs_calls ==
+           rk98::s * history_statistics.accepted_steps);
+    ASSERT(history_statistics.history_lookups > 0);
+    ASSERT(history_statistics.history_searches <
+           history_statistics.history_lookups);
+  }
+
+  { // the past is stored, if a lambda handler may evaluate it
+    auto [x_delayed] = equation::LinearODE1().solution(
+        0., 2., ConstantStepsize(0.01),
+        make_tuple(StepEvent([](const auto &state) {
+          return state.template eval<0, 0>(state.t_curr - 1.);
+        })));
+    ASSERT(abs(x_delayed.front() - exp(1.)) < 1e-10);
+    ASSERT(abs(x_delayed.back() - exp(-1.)) < 1e-10);
+  }
+
+  if (error_count == 0) {
+    cout << "All tests finished succesfully" << endl;
+  } else {
+    cout << error_count << " assertions failed." << endl;
+  }
+}
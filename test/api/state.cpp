@@ -0,0 +1,173 @@
+#include <iostream>
+
+#include "../../diffurch.hpp"
+#include <tuple>
+
+using namespace std;
+using namespace diffurch;
+using namespace diffurch::variables_xyz_t;
+
+int error_count = 0;
+
+#define ASSERT(condition)                                                      \
+  if (!(condition)) {                                                          \
+    cout << "Assertion failed at " << __FILE__ << ":" << __LINE__ << endl;     \
+    error_count++;                                                             \
+  }
+
+// delayed system, where each equation uses delayed values of different
+// coordinates
+struct DelayedSystem : Solver<DelayedSystem> {
+  auto get_rhs() {
+    return y(t - 1.) | -x(t - 0.5) + 0.1 * z | sin(D(y)(t - 2.)) - z;
+  }
+  auto get_ic() { return sin(t) | cos(t) | 0. * t; }
+};
+
+struct Ode : Solver<Ode> {
+  auto get_rhs() { return y | -x | x * y - z; }
+  auto get_ic() { return sin(t) | cos(t) | 0. * t; }
+};
+
+int main() {
+  { // the history policy is selected at compile time
+    bool ode_stores_history = true;
+    bool dde_stores_history = false;
+    // the handlers read only the current step
+    auto ode_handler = handler_reading(Variable<>(), [&](const auto &state) {
+      ode_stores_history = state.stores_history;
+    });
+    auto dde_handler = handler_reading(Variable<>(), [&](const auto &state) {
+      dde_stores_history = state.stores_history;
+    });
+    Ode().solution(0., 10., ConstantStepsize(0.1),
+                   make_tuple(StopEvent(nullptr, ode_handler)));
+    DelayedSystem().solution(0., 10., ConstantStepsize(0.1),
+                             make_tuple(StopEvent(nullptr, dde_handler)));
+    ASSERT(!ode_stores_history);
+    ASSERT(dde_stores_history);
+
+    // the lambda, that may evaluate the past, requires the history
+    bool lambda_stores_history = false;
+    Ode().solution(0., 10., ConstantStepsize(0.1),
+                   make_tuple(StopEvent(nullptr, [&](const auto &state) {
+                     lambda_stores_history = state.stores_history;
+                   })));
+    ASSERT(lambda_stores_history);
+  }
+
+  { // the transposed layout of the history gives the same solution
+    auto events = make_tuple(StepEvent(x | y | z | x(t - 1.5) | D(z)(t - 0.7)));
+    auto sol = DelayedSystem().solution<rk98, StepHistory>(
+        0., 20., ConstantStepsize(0.05), events);
+    auto sol_transposed =
+        DelayedSystem().solution<rk98, TransposedStepHistory>(
+            0., 20., ConstantStepsize(0.05), events);
+    ASSERT(sol == sol_transposed);
+  }
+
+  { // evaluation of separate coordinates
+    auto check_coordinates = [&](const auto &state) {
+      for (double t : {state.t_curr - 0.3, state.t_curr - 2.5, -1.}) {
+        auto x = state.eval(t);
+        auto Dx = state.template eval<1>(t);
+        ASSERT((state.template eval<0, 0>(t) == x[0]));
+        ASSERT((state.template eval<0, 2>(t) == x[2]));
+        ASSERT((state.template eval<1, 1>(t) == Dx[1]));
+      }
+    };
+    DelayedSystem().solution<rk98, StepHistory>(
+        0., 10., ConstantStepsize(0.1),
+        make_tuple(StopEvent(nullptr, check_coordinates)));
+    DelayedSystem().solution<rk98, TransposedStepHistory>(
+        0., 10., ConstantStepsize(0.1),
+        make_tuple(StopEvent(nullptr, check_coordinates)));
+  }
+
+  { // second derivative of the interpolation, x'' = -x
+    Ode().solution(0., 10., ConstantStepsize(0.1),
+                   make_tuple(StepEvent(nullptr, [&](const auto &state) {
+                     // the last step can be very short due to rounding
+                     if (state.t_curr - state.t_prev > 0.05) {
+                       double t = 0.5 * (state.t_prev + state.t_curr);
+                       ASSERT(abs(state.template eval<2, 0>(t) +
+                                  state.template eval<0, 0>(t)) < 1e-5);
+                     }
+                   })));
+  }
+
+  { // event location with different root finding methods
+    struct Harmonic : Solver<Harmonic> {
+      auto get_rhs() { return y | -x; }
+      auto get_ic() { return sin(t) | cos(t); }
+    };
+    auto zeros = [](auto root_finder) {
+      auto [t_zero] = Harmonic().solution(
+          0., 10., ConstantStepsize(0.1),
+          make_tuple(Event(When(x == 0, root_finder), t)));
+      return t_zero;
+    };
+    for (auto t_zero : {zeros(Bisection()), zeros(Illinois()),
+                        zeros(Brent()), zeros(Newton())}) {
+      ASSERT(t_zero.size() == 3);
+      for (size_t i = 0; i < t_zero.size(); i++) {
+        ASSERT(abs(t_zero[i] - M_PI * (i + 1)) < 1e-12);
+      }
+    }
+  }
+
+  { // the step is truncated at the located event by interpolation
+    struct Harmonic : Solver<Harmonic> {
+      auto get_rhs() { return y | -x; }
+      auto get_ic() { return sin(t) | cos(t); }
+    };
+    auto [t_zero, x_zero] = Harmonic().solution(
+        0., 10., ConstantStepsize(0.1), make_tuple(Event(When(x == 0), t | x)),
+        InterpolateAtEvents());
+    ASSERT(t_zero.size() == 3);
+    for (size_t i = 0; i < t_zero.size(); i++) {
+      ASSERT(abs(t_zero[i] - M_PI * (i + 1)) < 1e-12);
+      ASSERT(abs(x_zero[i]) < 1e-12);
+    }
+
+    // the history of truncated steps is interpolated with the length of the
+    // whole step; z depends on the derivative of the dense output, which is
+    // less accurate
+    auto events = make_tuple(Event(When(y == 0), x | y | z),
+                             StopEvent(x | y | z | x(t - 1.5)));
+    auto sol = DelayedSystem().solution(0., 20., ConstantStepsize(0.05), events);
+    auto sol_interpolated = DelayedSystem().solution(
+        0., 20., ConstantStepsize(0.05), events, InterpolateAtEvents());
+    auto [x_event, y_event, z_event, x_stop, y_stop, z_stop, x_delayed] = sol;
+    auto [x_event_i, y_event_i, z_event_i, x_stop_i, y_stop_i, z_stop_i,
+          x_delayed_i] = sol_interpolated;
+    ASSERT(x_event.size() > 0 && x_event.size() == x_event_i.size());
+    for (size_t i = 0; i < x_event.size(); i++) {
+      ASSERT(abs(x_event[i] - x_event_i[i]) < 1e-10 * abs(x_event[i]));
+      ASSERT(abs(z_event[i] - z_event_i[i]) < 1e-6 * abs(z_event[i]));
+    }
+    ASSERT(abs(x_stop[0] - x_stop_i[0]) < 1e-10 * abs(x_stop[0]));
+    ASSERT(abs(z_stop[0] - z_stop_i[0]) < 1e-6 * abs(z_stop[0]));
+    ASSERT(abs(x_delayed[0] - x_delayed_i[0]) < 1e-10 * abs(x_delayed[0]));
+  }
+
+  { // the derivative of an initial function without eval is approximated by
+    // the backward difference, if it is wrapped in BackwardDifference
+    struct Neutral : Solver<Neutral> {
+      auto get_rhs() { return Vector(D(x)(t - 1.)); }
+      auto get_ic() {
+        return BackwardDifference{[](double t) { return Vec<1>{t * t}; }};
+      }
+    };
+    // x' = 2 (t - 1) on [0, 1], and the backward difference is exact for t^2
+    auto [x_stop] = Neutral().solution(0., 1., ConstantStepsize(0.1),
+                                       make_tuple(StopEvent(x)));
+    ASSERT(abs(x_stop[0] + 1.) < 1e-8);
+  }
+
+  if (error_count == 0) {
+    cout << "All tests finished succesfully" << endl;
+  } else {
+    cout << error_count << " assertions failed." << endl;
+  }
+}
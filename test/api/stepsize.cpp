@@ -0,0 +1,191 @@
+#include <iostream>
+
+#include "../../diffurch.hpp"
+#include <array>
+#include <cmath>
+#include <tuple>
+
+using namespace std;
+using namespace diffurch;
+using namespace diffurch::variables_xyz_t;
+
+int error_count = 0;
+
+#define ASSERT(condition)                                                      \
+  if (!(condition)) {                                                          \
+    cout << "Assertion failed at " << __FILE__ << ":" << __LINE__ << endl;     \
+    error_count++;                                                             \
+  }
+
+// the Lorenz system from the initial state (1, 2, 20)
+auto lorenz() { return equation::Lorenz(10., 28., 8. / 3., {1., 2., 20.}); }
+
+// the members of State, that are used by the stepsize controllers
+struct ErrorState {
+  static constexpr size_t n = 2;
+  array<double, n> x_prev;
+  array<double, n> x_curr;
+  array<double, n> error_curr;
+  double t_prev = 0.;
+  double t_step = 0.;
+};
+
+int main() {
+  { // error norms
+    ErrorState state{{1., -4.}, {3., 2.}, {1e-3, -2e-3}};
+    // scales are 1 + 1e-3 * 3 and 1 + 1e-3 * 4
+    double e0 = 1e-3 / 1.003, e1 = 2e-3 / 1.004;
+    ASSERT(abs(scaled_error_norm(state, 1., 1e-3, false) - e1) < 1e-15);
+    ASSERT(abs(scaled_error_norm(state, 1., 1e-3, true) -
+               sqrt((e0 * e0 + e1 * e1) / 2)) < 1e-15);
+  }
+
+  auto solve = [](auto controller) {
+    return lorenz().solution(0., 10., controller,
+                             make_tuple(StopEvent(t | x | y | z)),
+                             CollectStatistics());
+  };
+  double tol = 1e-8;
+  auto reference = solve(ConstantStepsize(1e-4));
+
+  { // PI and PID controllers reject less steps than I controller
+    auto [t_i, x_i, y_i, z_i, statistics_i] =
+        solve(AdaptiveStepsize{.atol = tol, .rtol = tol});
+    auto [t_pi, x_pi, y_pi, z_pi, statistics_pi] =
+        solve(PIStepsize{.atol = tol, .rtol = tol});
+    auto [t_pid, x_pid, y_pid, z_pid, statistics_pid] =
+        solve(PIDStepsize{.atol = tol, .rtol = tol});
+    ASSERT(statistics_pi.rejected_steps < statistics_i.rejected_steps);
+    ASSERT(statistics_pid.rejected_steps < statistics_i.rejected_steps);
+    ASSERT(abs(x_pi[0] - get<1>(reference)[0]) < 1e-5);
+    ASSERT(abs(x_pid[0] - get<1>(reference)[0]) < 1e-5);
+  }
+
+  { // the digital filter with only beta1 = 1 is the same as PI with alpha = 1
+    // and beta = 0, that is, the I controller
+    auto pi = solve(
+        PIStepsize{.atol = tol, .rtol = tol, .alpha = 1., .beta = 0.});
+    auto pid = solve(PIDStepsize{
+        .atol = tol, .rtol = tol, .beta1 = 1., .beta2 = 0., .beta3 = 0.});
+    ASSERT(pi == pid);
+  }
+
+  { // the steps of the minimal size are accepted
+    auto [t_, x_, y_, z_, statistics] =
+        solve(PIStepsize{.atol = 1e-16,
+                         .rtol = 1e-16,
+                         .initial_stepsize = 1e-2,
+                         .min_stepsize = 1e-2});
+    ASSERT(t_[0] == 10.);
+    ASSERT(statistics.rejected_steps == 0);
+  }
+
+  { // the step of the minimal size is accepted by AdaptiveStepsize, and the
+    // larger step with the same error is rejected
+    ErrorState state{{1., 1.}, {1., 1.}, {1., 1.}};
+    AdaptiveStepsize controller{.atol = 1e-6, .rtol = 1e-6};
+    state.t_step = controller.min_stepsize;
+    ASSERT(!controller.set_stepsize<rk98>(state));
+    ASSERT(state.t_step == controller.min_stepsize);
+    state.t_step = 2 * controller.min_stepsize;
+    ASSERT(controller.set_stepsize<rk98>(state));
+    ASSERT(state.t_step == controller.min_stepsize);
+  }
+
+  { // initial stepsize estimate for the problem on a short time scale
+    auto solve_fast = [](bool automatic) {
+      return equation::LinearODE1(-1e4, 1.).solution(
+          0., 1e-3,
+          AdaptiveStepsize{.atol = 1e-6,
+                           .rtol = 1e-6,
+                           .automatic_initial_stepsize = automatic},
+          make_tuple(StepEvent(t), StopEvent(x)), CollectStatistics());
+    };
+    auto [t_manual, x_manual, statistics_manual] = solve_fast(false);
+    auto [t_automatic, x_automatic, statistics_automatic] = solve_fast(true);
+    ASSERT(statistics_automatic.rhs_calls < statistics_manual.rhs_calls);
+    ASSERT(statistics_automatic.rejected_steps <
+           statistics_manual.rejected_steps);
+    // without the estimate, the first step (clipped to the interval 1e-3) is
+    // rejected three times, each time reduced at most max_factor times, and
+    // it is accepted before min_stepsize
+    AdaptiveStepsize defaults;
+    ASSERT(statistics_manual.rejected_steps == 3);
+    ASSERT(t_manual[1] < 1e-3 &&
+           t_manual[1] >= 1e-3 / pow(defaults.max_factor, 3));
+    ASSERT(t_automatic[1] >= defaults.min_stepsize &&
+           t_automatic[1] <= defaults.max_stepsize);
+    ASSERT(abs(x_automatic[0] - exp(-10.)) < 1e-8);
+
+    // the estimate is clamped to [min_stepsize, max_stepsize]
+    auto [t_clamped, x_clamped] =
+        equation::LinearODE1(-1e4, 1.).solution(
+            0., 1e-3,
+            AdaptiveStepsize{.atol = 1e-6,
+                             .rtol = 1e-6,
+                             .max_stepsize = 1e-5,
+                             .automatic_initial_stepsize = true},
+            make_tuple(StepEvent(t), StopEvent(x)));
+    ASSERT(t_clamped[1] <= 1e-5);
+
+    // the estimate of Hairer and Wanner evaluates f once, after the explicit
+    // Euler step from t0 with f0 = f(t0, x0), and for x' = -x it scales with
+    // the tolerance as tol^(1 / (order + 1))
+    auto estimate = [](double tolerance, size_t order) {
+      size_t calls = 0;
+      double t_call = 0., x_call = 0.;
+      auto f = [&](double t, const array<double, 1> &x) {
+        calls++;
+        t_call = t;
+        x_call = x[0];
+        return array<double, 1>{-x[0]};
+      };
+      double h = initial_stepsize_estimate(f, order, 1., array<double, 1>{1.},
+                                           array<double, 1>{-1.}, tolerance,
+                                           tolerance);
+      ASSERT(calls == 1);
+      ASSERT(t_call > 1. && abs(x_call - (1. - (t_call - 1.))) < 1e-15);
+      return h;
+    };
+    for (size_t order : {4, 8}) {
+      double ratio = estimate(1e-6, order) / estimate(1e-8, order);
+      ASSERT(abs(ratio / pow(100., 1. / (order + 1.)) - 1.) < 1e-12);
+    }
+
+    // the first stage of the estimate is reused in the first step, so it
+    // takes only one additional evaluation of the right hand side
+    auto f = [](double, const array<double, 1> &x) {
+      return array<double, 1>{-1e4 * x[0]};
+    };
+    double h = initial_stepsize_estimate(f, rk98::order, 0.,
+                                         array<double, 1>{1.},
+                                         array<double, 1>{-1e4}, 1e-6, 1e-6);
+    auto solve_pi = [](PIStepsize controller) {
+      return equation::LinearODE1(-1e4, 1.).solution(
+          0., 1e-3, controller, make_tuple(StepEvent(t | x)),
+          CollectStatistics());
+    };
+    auto [t_estimated, x_estimated, statistics_estimated] = solve_pi(
+        {.atol = 1e-6, .rtol = 1e-6, .automatic_initial_stepsize = true});
+    auto [t_given, x_given, statistics_given] =
+        solve_pi({.atol = 1e-6, .rtol = 1e-6, .initial_stepsize = h});
+    ASSERT(t_estimated == t_given && x_estimated == x_given);
+    ASSERT(statistics_estimated.rhs_calls == statistics_given.rhs_calls + 1);
+  }
+
+  { // the error is not estimated for the constant stepsize, so the tables
+    // without embedded method can be used
+    static_assert(!uses_error_v<ConstantStepsize>);
+    static_assert(uses_error_v<AdaptiveStepsize>);
+    static_assert(uses_error_v<PIStepsize> && uses_error_v<PIDStepsize>);
+    auto [x_rk4] = equation::LinearODE1(-2., 1.).solution<rk4>(
+        0., 1., ConstantStepsize(0.01), make_tuple(StopEvent(x)));
+    ASSERT(abs(x_rk4[0] - exp(-2.)) < 1e-9);
+  }
+
+  if (error_count == 0) {
+    cout << "All tests finished succesfully" << endl;
+  } else {
+    cout << error_count << " assertions failed." << endl;
+  }
+}
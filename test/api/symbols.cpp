@@ -70,6 +70,96 @@ int main() {
     ASSERT(D(f)(4.) == 3. * 2. * cos(2. * 4.));
   }
 
+  { // derivative of the functions is not affected by their names
+    static_assert(
+        is_same_v<decltype(D(exp(x))), decltype(exp(x) * Variable<0, 1>())>);
+  }
+
+  { // the constants known at compile time are folded
+    static_assert(is_same_v<decltype(D(Constant(2.))), Zero>);
+    static_assert(is_same_v<decltype(D(t)), One>);
+    static_assert(is_same_v<decltype(D(t - 1.)), One>);
+    static_assert(is_same_v<decltype(D(x(t - 1.))),
+                            decltype(Variable<0, 1>()(t - 1.))>);
+    static_assert(is_same_v<decltype(D(2. * x)), decltype(2. * D(x))>);
+    static_assert(is_same_v<decltype(D<2>(t * t)), StaticConstant<2.>>);
+    static_assert(is_same_v<decltype(Zero() - D<2>(x)), decltype(-D<2>(x))>);
+    static_assert(is_same_v<decltype(-(-x)), Variable<0>>);
+    // the nested nodes of the same kind are not copies of the inner one
+    ASSERT(sin(sin(t))(1.) == std::sin(std::sin(1.)));
+    static_assert(is_same_v<decltype(D<Variable<0>>(x * x + y * sin(t))),
+                            decltype(x + x)>);
+    // the runtime constants are merged, but not compared with zero
+    ASSERT((2. * (3. * x))(state) == 6. * 0.01);
+    static_assert(is_same_v<decltype(2. * (3. * x)), decltype(6. * x)>);
+    static_assert(
+        is_same_v<decltype(0. * x), Mul<Constant<double>, Variable<0>>>);
+    ASSERT(D<2>(sin(2. * t))(4.) == -sin(2. * 4.) * 2. * 2.);
+  }
+
+  { // partial derivatives
+    auto f = x * y + sin(t) * z;
+    ASSERT(D<Variable<0>>(f)(state) == 0.02);
+    ASSERT(D<decltype(y)>(f)(state) == 0.01);
+    ASSERT(D<Variable<2>>(f)(state) == sin(42.));
+    ASSERT(D<TimeVariable>(f)(state) == cos(42.) * 0.03);
+    ASSERT(D<Variable<1>>(x(t - 1.) * y).max_delay() == 1.);
+    static_assert(!is_partial_variable_v<Variable<>>);
+    static_assert(!is_partial_variable_v<Variable<0, 1>>);
+  }
+
+  { // Jacobian matrix
+    auto J = jacobian(x * y | sin(z) | t * x)(state);
+    ASSERT((J == array<array<double, 3>, 3>{
+                     {{0.02, 0.01, 0.}, {0., 0., cos(0.03)}, {42., 0., 0.}}}));
+    ASSERT((gradient<3>(x * y * z)(state) ==
+            array<double, 3>{0.02 * 0.03, 0.01 * 0.03, 0.01 * 0.02}));
+  }
+
+  { // delays of the delayed arguments
+    ASSERT((x + sin(y)).max_delay() == 0.);
+    ASSERT(x(t - 2.).max_delay() == 2.);
+    ASSERT((x(t - 1.) + y(t - 3.) * z).max_delay() == 3.);
+    ASSERT((x(t - 1.) | D(y)((t - 1.) - 0.5)).max_delay() == 1.5);
+    ASSERT(D(x(t - 2.)).max_delay() == 2.);
+    ASSERT(x(t + 1.).max_delay() == 0.);
+    ASSERT(x(t - x(t - 1.)).max_delay() == numeric_limits<double>::infinity());
+  }
+  { // detection of delayed arguments at compile time
+    static_assert(!has_delayed_variable_v<decltype(x + sin(y) * t)>);
+    static_assert(has_delayed_variable_v<decltype(x + sin(y(t - 1.)))>);
+    static_assert(has_delayed_variable_v<decltype(When(x(t - 1.) == 0))>);
+    static_assert(!has_delayed_variable_v<decltype(When(x == 0))>);
+    // the lambdas may evaluate the past, unless they declare what they read
+    auto handler = [](const auto &state) { return state.t_curr; };
+    static_assert(has_delayed_variable_v<decltype(StepEvent(handler))>);
+    static_assert(!has_delayed_variable_v<decltype(StepEvent(
+                      handler_reading(x, handler)))>);
+    static_assert(!has_delayed_variable_v<decltype(StopEvent(x))>);
+    static_assert(!has_delayed_variable_v<decltype(dsign(x).get_events())>);
+  }
+
+  { // common subexpressions
+    auto e = sin(x * y) + cos(x * y) * sin(x * y) | 2. * sin(x * y);
+    SharedSubexpressions shared_e(e);
+    static_assert(decltype(shared_e)::slots == 1);
+    ASSERT(shared_e.is_shared[0]);
+    ASSERT((shared_e(e, state) == e(state)));
+
+    // the subexpressions of the same type with different constants
+    auto f = sin(2. * x) + sin(3. * x) | sin(2. * x);
+    SharedSubexpressions shared_f(f);
+    static_assert(decltype(shared_f)::slots == 1);
+    ASSERT(!shared_f.is_shared[0]);
+    ASSERT((shared_f(f, state) == f(state)));
+
+    // the single operations are not shared
+    static_assert(SharedSubexpressions<decltype(x * y + x * y)>::slots == 0);
+
+    auto J = jacobian(x * exp(y * z) | exp(y * z) * y | sin(x) * x);
+    ASSERT((SharedSubexpressions(J)(J, state) == J(state)));
+  }
+
   if (error_count == 0) {
     cout << "All tests finished succesfully" << endl;
   } else {